@@ -0,0 +1,171 @@
+/*  File:    adversarial.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Worst-case MessagePack decoding benchmarks
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(library(time)).
+:- use_module(bench).
+
+:- initialization(main, main).
+
+/** <module> Adversarial decoding benchmarks
+
+Times decoding of pathological inputs, where cost relative to size can
+far exceed that of ordinary traffic. The grammars decode by
+backtracking through the formats, so inputs that nearly match, declare
+huge lengths, nest deeply or fail only at the very end can cost far
+more than their size suggests. The C decoder runs once with default
+options and once with budgets, the configuration recommended for
+untrusted input.
+
+Each report gives the outcome, `accept`, `reject`, `timeout` or the
+formal error term, the time per byte, and the global-stack and codec
+heap bytes per input byte retained by the decoded term. The optional
+argument sets the size parameter, default 10000; a time limit of ten
+seconds per case bounds the worst offenders.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 10 000, Size),
+    bench_version(Version),
+    forall(( case(Size, Case, Bytes),
+             decoder(Decoder, Bytes, Goal)
+           ),
+           adversarial(Version, Case, Decoder, Bytes, Goal)).
+
+%!  case(+Size, -Case, -Bytes) is nondet.
+%
+%   Pathological inputs of roughly Size bytes.
+
+case(Size, fixstr_truncated, Bytes) :-
+    % Fixstr headers claiming 31 bytes but followed by 30, so that
+    % each header swallows the next and the last runs out.
+    length(Payload, 30),
+    maplist(=(0x61), Payload),
+    Count is Size // 31,
+    length(Chunks, Count),
+    maplist(=([0xbf|Payload]), Chunks),
+    be32(Count, Length),
+    append([[0xdd|Length]|Chunks], Bytes).
+case(Size, fixarray_truncated, Bytes) :-
+    % Nested fixarrays each claiming 15 elements but holding one.
+    length(Bytes0, Size),
+    maplist(=(0x9f), Bytes0),
+    append(Bytes0, [0xc0], Bytes).
+case(_, str32_huge, [0xdb, 0xff, 0xff, 0xff, 0xff, 0x61]).
+case(_, bin32_huge, [0xc6, 0xff, 0xff, 0xff, 0xff, 0x00]).
+case(_, array32_huge, [0xdd, 0xff, 0xff, 0xff, 0xff, 0xc0]).
+case(_, map32_huge, [0xdf, 0xff, 0xff, 0xff, 0xff, 0xc0, 0xc0]).
+case(_, ext32_huge, [0xc9, 0xff, 0xff, 0xff, 0xff, 0x01, 0x00]).
+case(Size, deep_arrays, Bytes) :-
+    length(Bytes0, Size),
+    maplist(=(0x91), Bytes0),
+    append(Bytes0, [0xc0], Bytes).
+case(Size, deep_maps, Bytes) :-
+    Count is Size // 2,
+    length(Pairs, Count),
+    maplist(=([0x81, 0xc0]), Pairs),
+    append(Pairs, Bytes0),
+    append(Bytes0, [0xc0], Bytes).
+case(Size, late_invalid, Bytes) :-
+    % A long array of nils whose final element is never used.
+    Count is Size - 5,
+    length(Nils, Count),
+    maplist(=(0xc0), Nils),
+    be32(Count, Length),
+    append([[0xdd|Length], Nils, [0xc1]], Bytes).
+case(Size, bad_utf8, [0xdb|Bytes]) :-
+    % Valid UTF-8 up to the last byte, a dangling lead byte.
+    Count is Size - 1,
+    length(Codes, Count),
+    maplist(=(0x61), Codes),
+    append(Codes, [0xc3], Payload),
+    be32(Size, Length),
+    append(Length, Payload, Bytes).
+
+be32(Int, [B3, B2, B1, B0]) :-
+    B3 is Int >> 24 /\ 0xff,
+    B2 is Int >> 16 /\ 0xff,
+    B1 is Int >> 8 /\ 0xff,
+    B0 is Int /\ 0xff.
+
+decoder('msgpack//1', Bytes, phrase(msgpack(_), Bytes)).
+decoder('msgpack_object//1', Bytes, phrase(msgpack_object(_), Bytes)).
+decoder('msgpack_decode//1', Bytes, phrase(msgpack_decode(_), Bytes)).
+decoder('msgpack_decode//2', Bytes, phrase(msgpack_decode(_, Options), Bytes)) :-
+    length(Bytes, Length),
+    Options = [ max_depth(64),
+                max_elements(Length),
+                max_str_bytes(Length),
+                max_total_bytes(Length),
+                strict(true)
+              ].
+
+adversarial(Version, Case, Decoder, Bytes, Goal) :-
+    length(Bytes, Length),
+    get_time(Start),
+    catch(call_with_time_limit(10, outcome(Goal, Outcome, Usage)),
+          Error, error_outcome(Error, Outcome, Usage)),
+    get_time(End),
+    Seconds is End - Start,
+    NanosecondsPerByte is Seconds * 1e9 / Length,
+    usage_per_byte(global, Usage, Length, GlobalPerByte),
+    usage_per_byte(c_bytes, Usage, Length, CBytesPerByte),
+    bench_report(_{ bench:adversarial,
+                    version:Version,
+                    case:Case,
+                    decoder:Decoder,
+                    bytes:Length,
+                    outcome:Outcome,
+                    seconds:Seconds,
+                    ns_per_byte:NanosecondsPerByte,
+                    global_bytes_per_byte:GlobalPerByte,
+                    c_bytes_per_byte:CBytesPerByte
+                  }).
+
+outcome(Goal, Outcome, Usage) :-
+    (   msgpack_accounting(Goal, Usage)
+    ->  Outcome = accept
+    ;   Outcome = reject,
+        Usage = []
+    ).
+
+error_outcome(time_limit_exceeded, timeout, []) :- !.
+error_outcome(error(Formal, _), Outcome, []) :-
+    !,
+    format(string(Outcome), '~q', [Formal]).
+error_outcome(Error, Outcome, []) :-
+    format(string(Outcome), '~q', [Error]).
+
+usage_per_byte(Name, Usage, Length, PerByte) :-
+    Term =.. [Name, Bytes],
+    (   memberchk(Term, Usage)
+    ->  PerByte is Bytes / Length
+    ;   PerByte = null
+    ).
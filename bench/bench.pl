@@ -0,0 +1,133 @@
+/*  File:    bench.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Benchmark utilities for msgpackc
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- module(bench,
+          [ bench_loop/3,                       % :Goal,+Iterations,-Seconds
+            bench_global/2,                     % :Goal,-Bytes
+            bench_iterations/3,                 % +Argv,+Default,-Iterations
+            bench_report/1,                     % +Dict
+            bench_version/1                     % -Version
+          ]).
+:- autoload(library(http/json), [json_write_dict/3]).
+:- autoload(library(msgpackc), [msgpack_accounting/2]).
+
+:- meta_predicate
+    bench_loop(0, +, -),
+    bench_global(0, -).
+
+/** <module> Benchmark utilities
+
+Utilities shared by the benchmark scripts: timing loops, global-stack
+measurement and machine-readable reports, one JSON object per line.
+
+*/
+
+%!  bench_loop(:Goal, +Iterations:nonneg, -Seconds:float) is det.
+%
+%   Calls Goal Iterations times in a failure-driven loop and unifies
+%   Seconds with the elapsed wall-clock time, less the time of the same
+%   loop calling `true`. Backtracking releases the global stack between
+%   iterations. Throws if Goal fails on its first call, since timing a
+%   failing goal measures nothing useful.
+
+bench_loop(Goal, Iterations, Seconds) :-
+    (   \+ \+ Goal
+    ->  true
+    ;   throw(error(bench_failed(Goal), _))
+    ),
+    loop(Goal, Iterations, Seconds0),
+    loop(true, Iterations, Seconds1),
+    Seconds is max(0, Seconds0 - Seconds1).
+
+loop(Goal, Iterations, Seconds) :-
+    get_time(Start),
+    (   between(1, Iterations, _),
+        call(Goal),
+        fail
+    ;   true
+    ),
+    get_time(End),
+    Seconds is End - Start.
+
+%!  bench_global(:Goal, -Bytes:integer) is det.
+%
+%   Bytes of global stack that one call of Goal leaves in use.
+
+bench_global(Goal, Bytes) :-
+    msgpack_accounting(Goal, Usage),
+    memberchk(global(Bytes), Usage).
+
+%!  bench_iterations(+Argv:list, +Default:positive_integer,
+%!                   -Iterations) is det.
+%
+%   Iterations from the first command-line argument, else Default.
+%   Scales every benchmark together, e.g. for a quick subset.
+
+bench_iterations(Argv, Default, Iterations) :-
+    (   Argv = [Arg|_],
+        atom_number(Arg, Iterations),
+        integer(Iterations)
+    ->  true
+    ;   Iterations = Default
+    ).
+
+%!  bench_report(+Dict:dict) is det.
+%
+%   Writes Dict as JSON on one line of the current output.
+
+bench_report(Dict) :-
+    json_write_dict(current_output, Dict, [width(0)]),
+    nl.
+
+%!  bench_version(-Version:atom) is det.
+%
+%   Version of the pack under benchmark, from its `pack.pl` file, so
+%   that reports from different releases compare side by side.
+
+:- dynamic pack_directory/1.
+
+:- prolog_load_context(directory, Directory),
+   file_directory_name(Directory, Pack),
+   assertz(pack_directory(Pack)).
+
+bench_version(Version) :-
+    pack_directory(Pack),
+    directory_file_path(Pack, 'pack.pl', File),
+    setup_call_cleanup(
+        open(File, read, Stream),
+        pack_version(Stream, Version),
+        close(Stream)).
+
+pack_version(Stream, Version) :-
+    read_term(Stream, Term, []),
+    (   Term == end_of_file
+    ->  Version = unknown
+    ;   Term = version(Version)
+    ->  true
+    ;   pack_version(Stream, Version)
+    ).
@@ -0,0 +1,138 @@
+/*  File:    compare.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Comparative serialisation benchmarks
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(library(http/json)).
+:- use_module(library(utf8)).
+:- use_module(bench).
+:- use_module(corpus).
+
+:- initialization(main, main).
+
+/** <module> Comparative benchmarks
+
+Runs each corpus through msgpackc and through the serialisations built
+into SWI-Prolog: fast_term_serialized/2, library(http/json) and plain
+term writing and reading, the string equivalent of term_to_atom/2
+without filling the atom table. Reports encoded size, encode time and
+decode time side by side as JSON lines.
+
+Each format serialises its natural representation of the same data.
+MessagePack encodes the msgpack//1 terms through the grammar and through
+the C codec. The term ext, under ext type 80, encodes the same terms
+wrapped as term(Term) through the C codec. The term formats serialise
+the msgpack//1 terms as Prolog terms. JSON serialises the
+msgpack_object//1 form with dicts for maps, and only for corpora without
+binaries or extensions; JSON has no timestamps, so the timestamps corpus
+skips it.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 200, Count),
+    bench_version(Version),
+    msgpack_register_term_ext(80),
+    forall(corpus(Kind), compare(Version, Kind, Count)).
+
+compare(Version, Kind, Count) :-
+    corpus(Kind, 1, Count, Terms),
+    forall(serialisation(Format, Kind, Terms, Data, Encode, Decode),
+           compare(Version, Kind, Count, Format, Data, Encode, Decode)).
+
+compare(Version, Kind, Count, Format, Data, Encode, Decode) :-
+    maplist(Encode, Data, Encoded),
+    foldl(size(Format), Encoded, 0, Size),
+    best_of(3, forall(member(Datum, Data), call(Encode, Datum, _)), EncodeSeconds),
+    best_of(3, forall(member(Encoding, Encoded), call(Decode, Encoding, _)), DecodeSeconds),
+    bench_report(_{ bench:compare,
+                    version:Version,
+                    corpus:Kind,
+                    format:Format,
+                    messages:Count,
+                    bytes:Size,
+                    encode_seconds:EncodeSeconds,
+                    decode_seconds:DecodeSeconds
+                  }).
+
+%!  serialisation(-Format, +Kind, +Terms, -Data, -Encode,
+%!                -Decode) is nondet.
+%
+%   Data is the corpus in the natural representation of Format. Encode
+%   and Decode are closures taking one datum to its encoding and back.
+
+serialisation('msgpack//1', _, Terms, Terms, msgpack_bytes, msgpack_term).
+serialisation('msgpack_encode//1', _, Terms, Terms, msgpack_encode_bytes, msgpack_decode_term).
+serialisation(term_ext, _, Terms, Wrapped, msgpack_encode_bytes, msgpack_decode_term) :-
+    maplist([Term, term(Term)]>>true, Terms, Wrapped).
+serialisation(fast_term_serialized, _, Terms, Terms, fast_string, fast_term).
+serialisation(term_string, _, Terms, Terms, write_string, read_string_term).
+serialisation(json, Kind, Terms, Objects, json_string, string_json) :-
+    Kind \== timestamps,
+    maplist(object, Terms, Objects).
+
+msgpack_bytes(Term, Bytes) :- phrase(msgpack(Term), Bytes).
+msgpack_term(Bytes, Term) :- phrase(msgpack(Term), Bytes).
+
+msgpack_encode_bytes(Term, Bytes) :- phrase(msgpack_encode(Term), Bytes).
+msgpack_decode_term(Bytes, Term) :- phrase(msgpack_decode(Term), Bytes).
+
+fast_string(Term, String) :- fast_term_serialized(Term, String).
+fast_term(String, Term) :- fast_term_serialized(Term, String).
+
+write_string(Term, String) :- format(string(String), '~k', [Term]).
+read_string_term(String, Term) :- term_string(Term, String).
+
+json_string(Object, String) :- atom_json_dict(String, Object, [as(string), width(0)]).
+string_json(String, Object) :- atom_json_dict(String, Object, [value_string_as(string)]).
+
+object(Term, Object) :-
+    phrase(msgpack(Term), Bytes),
+    phrase(msgpack_object(Object), Bytes).
+
+%!  size(+Format, +Encoded, +Size0, -Size) is det.
+%
+%   Adds the size in bytes of one Encoded datum. Byte lists and
+%   serialised strings hold one byte per element; text counts its UTF-8
+%   bytes.
+
+size(Format, Encoded, Size0, Size) :-
+    (   is_list(Encoded)
+    ->  length(Encoded, Length)
+    ;   Format == fast_term_serialized
+    ->  string_length(Encoded, Length)
+    ;   string_codes(Encoded, Codes),
+        phrase(utf8_codes(Codes), Bytes),
+        length(Bytes, Length)
+    ),
+    Size is Size0 + Length.
+
+best_of(Passes, Goal, Seconds) :-
+    length(Times, Passes),
+    maplist([Time]>>bench_loop(Goal, 1, Time), Times),
+    min_list(Times, Seconds).
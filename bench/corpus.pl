@@ -0,0 +1,187 @@
+/*  File:    corpus.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Reproducible MessagePack benchmark corpora
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- module(corpus,
+          [ corpus/1,                           % ?Kind
+            corpus/4                            % +Kind,+Seed,+Count,-Terms
+          ]).
+:- autoload(library(apply), [foldl/4]).
+:- autoload(library(lists), [numlist/3]).
+:- autoload(library(random), [random_between/3, random_member/2, random/1]).
+
+/** <module> Benchmark corpora
+
+Generates lists of msgpack//1 terms mimicking different traffic. The
+same Kind, Seed and Count always generate the same terms, whatever the
+platform, since generation draws only from the seeded random state.
+
+    - `telemetry` small maps of a few named readings.
+    - `documents` large string-heavy maps with nested arrays of
+    paragraphs.
+    - `numeric` long arrays of integers and floats of mixed widths.
+    - `nested` deep trees of small arrays and maps, of 256 nodes or
+    so at most.
+    - `timestamps` streams of records each carrying a timestamp
+    extension.
+
+*/
+
+%!  corpus(?Kind:atom) is nondet.
+%
+%   Kind of corpus.
+
+corpus(telemetry).
+corpus(documents).
+corpus(numeric).
+corpus(nested).
+corpus(timestamps).
+
+%!  corpus(+Kind:atom, +Seed:integer, +Count:nonneg, -Terms:list) is det.
+%
+%   Terms lists Count msgpack//1 terms of the given Kind, generated
+%   from random Seed. Restores the random state afterwards.
+
+corpus(Kind, Seed, Count, Terms) :-
+    must_be(oneof([telemetry, documents, numeric, nested, timestamps]), Kind),
+    setup_call_cleanup(
+        ( random_property(state(State)),
+          set_random(seed(Seed))
+        ),
+        length_terms(Count, Kind, Terms),
+        set_random(state(State))).
+
+length_terms(Count, Kind, Terms) :-
+    length(Terms, Count),
+    maplist(term(Kind), Terms).
+
+term(telemetry, map(Pairs)) :-
+    Names = [ "device", "sequence", "temperature", "humidity", "pressure",
+              "battery", "online", "status"
+            ],
+    maplist(telemetry, Names, Pairs).
+term(documents, map([ str("title")-str(Title),
+                      str("author")-str(Author),
+                      str("paragraphs")-array(Paragraphs),
+                      str("tags")-array(Tags)
+                    ])) :-
+    random_string(20, 80, Title),
+    random_string(5, 30, Author),
+    random_between(5, 20, ParagraphCount),
+    length(Paragraphs, ParagraphCount),
+    maplist(paragraph, Paragraphs),
+    random_between(0, 8, TagCount),
+    length(Tags, TagCount),
+    maplist(tag, Tags).
+term(numeric, array(Numbers)) :-
+    random_between(100, 1000, Length),
+    length(Numbers, Length),
+    maplist(number, Numbers).
+term(nested, Tree) :-
+    random_between(8, 24, Depth),
+    tree(Depth, Tree, 256, _).
+term(timestamps, array(Records)) :-
+    random_between(10, 50, Length),
+    length(Records, Length),
+    foldl(record, Records, 1 600 000 000, _).
+
+telemetry(Name, str(Name)-Value) :- reading(Name, Value).
+
+reading("device", str(Device)) :- random_string(8, 8, Device).
+reading("sequence", int(Sequence)) :- random_between(0, 0xffffffff, Sequence).
+reading("temperature", float(Float)) :- random(Random), Float is -40 + 80 * Random.
+reading("humidity", int(Int)) :- random_between(0, 100, Int).
+reading("pressure", float(Float)) :- random(Random), Float is 950 + 100 * Random.
+reading("battery", int(Int)) :- random_between(0, 4200, Int).
+reading("online", bool(Bool)) :- random_member(Bool, [false, true]).
+reading("status", nil).
+
+paragraph(str(String)) :- random_string(100, 1000, String).
+
+tag(str(String)) :- random_string(3, 12, String).
+
+number(Term) :-
+    random_between(0, 5, Kind),
+    number(Kind, Term).
+
+number(0, int(Int)) :- random_between(0, 127, Int).
+number(1, int(Int)) :- random_between(-32, -1, Int).
+number(2, int(Int)) :- random_between(0, 0xffff, Int).
+number(3, int(Int)) :- random_between(-0x80000000, 0x7fffffff, Int).
+number(4, int(Int)) :- random_between(0, 0xffffffffffffffff, Int).
+number(5, float(Float)) :- random(Random), Float is 1e6 * (Random - 0.5).
+
+%   Trees of random width at every level grow exponentially with depth,
+%   so the tree threads a budget of Nodes through its branches and ends
+%   each branch in a leaf once the budget runs out.
+
+tree(Depth, int(Int), Nodes0, Nodes) :-
+    (   Depth =:= 0
+    ;   Nodes0 =< 0
+    ),
+    !,
+    Nodes is Nodes0 - 1,
+    random_between(0, 127, Int).
+tree(Depth, Tree, Nodes0, Nodes) :-
+    Depth1 is Depth - 1,
+    Nodes1 is Nodes0 - 1,
+    random_between(1, 3, Width),
+    length(Trees, Width),
+    foldl(tree(Depth1), Trees, Nodes1, Nodes),
+    (   random_member(map, [array, map])
+    ->  numlist(1, Width, Keys),
+        maplist([Key, Value, int(Key)-Value]>>true, Keys, Trees, Pairs),
+        Tree = map(Pairs)
+    ;   Tree = array(Trees)
+    ).
+
+record(map([ str("at")-timestamp(Epoch),
+             str("value")-float(Value)
+           ]), Epoch0, Epoch) :-
+    random_between(1, 1 000 000, Micros),
+    Epoch is Epoch0 + Micros / 1 000 000,
+    random(Value).
+
+%!  random_string(+Min:nonneg, +Max:nonneg, -String:string) is det.
+%
+%   String of between Min and Max lower-case letters and spaces, with
+%   an occasional non-ASCII letter so that UTF-8 conversion does some
+%   work.
+
+random_string(Min, Max, String) :-
+    random_between(Min, Max, Length),
+    length(Codes, Length),
+    maplist(random_code, Codes),
+    string_codes(String, Codes).
+
+random_code(Code) :-
+    random_between(0, 31, Random),
+    random_code(Random, Code).
+
+random_code(Random, Code) :- Random < 26, !, Code is 0'a + Random.
+random_code(30, 0xe9) :- !.
+random_code(_, 0'\s).
@@ -0,0 +1,11 @@
+:- begin_tests(corpus).
+:- use_module(corpus).
+:- use_module(library(msgpackc)).
+:- use_module(library(plunit)).
+
+test(corpus, [forall(corpus(Kind)), true(Max =< 65 536)]) :-
+    corpus(Kind, 1, 50, Terms),
+    maplist([Term, Size]>>msgpack_size(Term, Size), Terms, Sizes),
+    max_list(Sizes, Max).
+
+:- end_tests(corpus).
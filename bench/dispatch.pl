@@ -0,0 +1,161 @@
+/*  File:    dispatch.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Ext hook dispatch scaling benchmarks
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(bench).
+
+:- initialization(main, main).
+
+/** <module> Ext dispatch scaling benchmarks
+
+Times the dispatch of ext objects through msgpack:type_ext_hook/3 as
+the number of hook clauses grows, from one clause to one for each of
+254 types. Each clause handles one type and one functor, the usual
+shape of an application's hooks. Every message holds 100 ext objects
+of the type added last, the worst case for a linear scan of the
+clauses.
+
+The C codec and the msgpack//1 grammar both dispatch by calling the
+hook, relying on SWI-Prolog's just-in-time clause indexing to select
+the clause by type when decoding and by functor when encoding. Each
+report gives the median nanoseconds per ext object over five runs, and
+the ratio to the one-clause case. Exits with status 1 if any ratio
+exceeds a limit, default 2, since per-object cost should stay flat.
+
+The optional arguments set the number of messages per run, default
+1000, and the limit.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 1000, Iterations),
+    (   Argv = [_, Arg|_],
+        atom_number(Arg, Limit)
+    ->  true
+    ;   Limit = 2
+    ),
+    bench_version(Version),
+    findall(Path/Op-(Clauses-Nanoseconds),
+            (   member(Clauses, [1, 4, 16, 64, 254]),
+                hooks(Clauses),
+                path(Clauses, Path, Op, Goal),
+                nanoseconds_per_object(Goal, Iterations, Nanoseconds)
+            ), Results),
+    hooks(0),
+    forall(member(Key-(Clauses-Nanoseconds), Results),
+           report(Version, Results, Key, Clauses, Nanoseconds)),
+    aggregate_all(count,
+                  (   member(Key-(_-Nanoseconds), Results),
+                      memberchk(Key-(1-Nanoseconds1), Results),
+                      Nanoseconds > Limit * Nanoseconds1
+                  ), Failures),
+    (   Failures =:= 0
+    ->  true
+    ;   format(user_error, '~d dispatch cost(s) beyond ~w times one clause~n',
+               [Failures, Limit]),
+        halt(1)
+    ).
+
+%!  hooks(+Clauses:nonneg) is det.
+%
+%   Loads Clauses clauses of msgpack:type_ext_hook/3, one for each of
+%   the first Clauses types, replacing those loaded before. Reloading
+%   the same source removes the old clauses.
+
+hooks(Clauses) :-
+    with_output_to(string(Text),
+                   (   portray_clause((:- multifile msgpack:type_ext_hook/3)),
+                       forall(between(1, Clauses, Clause),
+                              (   type(Clause, Type, Name),
+                                  Term =.. [Name, Ext],
+                                  portray_clause(msgpack:type_ext_hook(Type, Ext, Term))
+                              ))
+                   )),
+    setup_call_cleanup(
+        open_string(Text, Stream),
+        load_files(dispatch_hooks, [stream(Stream), silent(true)]),
+        close(Stream)).
+
+%!  type(+Clause:positive_integer, -Type:integer, -Name:atom) is det.
+%
+%   Type and functor Name of the hook clause numbered Clause: types 1
+%   through 127, then -2 through -128, skipping the timestamp type.
+
+type(Clause, Type, Name) :-
+    (   Clause =< 127
+    ->  Type = Clause
+    ;   Type is 126 - Clause
+    ),
+    format(atom(Name), 'ext~d', [Type]).
+
+%!  path(+Clauses, -Path, -Op, -Goal) is nondet.
+%
+%   Goal encodes or decodes one message of 100 ext objects of the last
+%   type of Clauses.
+
+path(Clauses, 'msgpack_decode//1', decode, phrase(msgpack_decode(_), Bytes)) :-
+    message(Clauses, Bytes, _).
+path(Clauses, 'msgpack//1', decode, phrase(msgpack(_), Bytes)) :-
+    message(Clauses, Bytes, _).
+path(Clauses, 'msgpack_encode//1', encode, phrase(msgpack_encode(Term), _)) :-
+    message(Clauses, _, Term).
+path(Clauses, 'msgpack//1', encode, phrase(msgpack(Term), _)) :-
+    message(Clauses, _, Term).
+
+message(Clauses, [0xdc, 0, 100|Bytes], array(Terms)) :-
+    type(Clauses, Type, Name),
+    Byte is Type /\ 0xff,
+    length(Exts, 100),
+    maplist(=([0xd4, Byte, 0]), Exts),
+    append(Exts, Bytes),
+    Term =.. [Name, [0]],
+    length(Terms, 100),
+    maplist(=(Term), Terms).
+
+nanoseconds_per_object(Goal, Iterations, Nanoseconds) :-
+    length(Times, 5),
+    maplist([Time]>>bench_loop(Goal, Iterations, Time), Times),
+    msort(Times, Sorted),
+    nth0(2, Sorted, Median),
+    Nanoseconds is Median * 1e9 / (Iterations * 100).
+
+report(Version, Results, Path/Op, Clauses, Nanoseconds) :-
+    memberchk(Path/Op-(1-Nanoseconds1), Results),
+    (   Nanoseconds1 > 0
+    ->  Ratio is Nanoseconds / Nanoseconds1
+    ;   Ratio = null
+    ),
+    bench_report(_{ bench:dispatch,
+                    version:Version,
+                    path:Path,
+                    op:Op,
+                    clauses:Clauses,
+                    ns_per_object:Nanoseconds,
+                    ratio:Ratio
+                  }).
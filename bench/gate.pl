@@ -0,0 +1,109 @@
+/*  File:    gate.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Performance regression gate
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(http/json)).
+:- use_module(library(readutil)).
+
+:- initialization(main, main).
+
+/** <module> Performance regression gate
+
+Compares the macro benchmark reports of a check run against a baseline,
+both JSON lines as written by macro.pl. Fails, exiting with status 1,
+when the median messages-per-second throughput of any corpus, path and
+operation falls more than a tolerance below its baseline. Tolerance is
+a fraction, default 0.25 for a quarter.
+
+Reports without a matching baseline pass with a note, for instance
+those of a new corpus. A missing or empty baseline fails outright
+rather than passing everything. Record a baseline with make
+bench-baseline on the machine that runs the gate; throughput on one
+machine says nothing about another.
+
+Arguments: baseline file, check file, optional tolerance.
+
+*/
+
+main([BaselineFile, CheckFile|Argv]) :-
+    (   Argv = [Arg|_]
+    ->  atom_number(Arg, Tolerance)
+    ;   Tolerance = 0.25
+    ),
+    (   exists_file(BaselineFile)
+    ->  reports(BaselineFile, Baselines)
+    ;   Baselines = []
+    ),
+    (   Baselines == []
+    ->  format(user_error, 'no baseline in ~w; run make bench-baseline~n', [BaselineFile]),
+        halt(1)
+    ;   true
+    ),
+    reports(CheckFile, Checks),
+    foldl(gate(Baselines, Tolerance), Checks, 0, Regressions),
+    (   Regressions == 0
+    ->  true
+    ;   format(user_error, '~d throughput regression(s)~n', [Regressions]),
+        halt(1)
+    ).
+
+%!  reports(+File, -Reports:list(pair)) is det.
+%
+%   Reports from the JSON lines of File as Key-MessagesPerSecond pairs
+%   where Key identifies the corpus, path and operation, and
+%   MessagesPerSecond is the median throughput.
+
+reports(File, Reports) :-
+    read_file_to_string(File, String, []),
+    split_string(String, "\n", "\s\t\r", Lines),
+    convlist(report, Lines, Reports).
+
+report(Line, Corpus/Path/Op-MessagesPerSecond) :-
+    Line \== "",
+    atom_json_dict(Line, Dict, []),
+    get_dict(bench, Dict, "macro"),
+    get_dict(corpus, Dict, Corpus),
+    get_dict(path, Dict, Path),
+    get_dict(op, Dict, Op),
+    get_dict(median_msgs_per_s, Dict, MessagesPerSecond),
+    number(MessagesPerSecond).
+
+gate(Baselines, Tolerance, Key-MessagesPerSecond, Regressions0, Regressions) :-
+    (   memberchk(Key-Baseline, Baselines)
+    ->  Ratio is MessagesPerSecond / Baseline,
+        (   Ratio < 1 - Tolerance
+        ->  format(user_error, 'REGRESSION ~w: ~2f msgs/s against ~2f (~2f)~n',
+                   [Key, MessagesPerSecond, Baseline, Ratio]),
+            Regressions is Regressions0 + 1
+        ;   format(user_error, 'ok ~w: ~2f msgs/s against ~2f (~2f)~n',
+                   [Key, MessagesPerSecond, Baseline, Ratio]),
+            Regressions = Regressions0
+        )
+    ;   format(user_error, 'no baseline ~w: ~2f msgs/s~n', [Key, MessagesPerSecond]),
+        Regressions = Regressions0
+    ).
@@ -0,0 +1,154 @@
+/*  File:    macro.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Macro benchmarks over generated MessagePack corpora
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(bench).
+:- use_module(corpus).
+
+:- initialization(main, main).
+
+/** <module> Macro benchmarks
+
+Encodes and decodes each corpus through every path: the msgpack//1
+grammar, the msgpack_object//1 grammar one message at a time, the
+msgpack_objects//1 grammar for the whole corpus as one sequence, and
+the C codec msgpack_encode//1 and msgpack_decode//1. Reports megabytes
+and messages per second as JSON lines.
+
+The optional arguments set the number of messages per corpus and the
+number of passes over the corpus, default three. Each report gives the
+best pass, fields `seconds` and `msgs_per_s`, and the median pass,
+fields `median_seconds` and `median_msgs_per_s`. The median, over
+enough passes, steadies the regression gate in gate.pl. A third
+argument, a comma-separated list of paths, runs only those paths; make
+check gates just the C codec paths that way.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 200, Count),
+    (   Argv = [_, Arg|_],
+        atom_number(Arg, Passes),
+        integer(Passes),
+        Passes > 0
+    ->  true
+    ;   Passes = 3
+    ),
+    (   Argv = [_, _, PathsArg|_]
+    ->  atomic_list_concat(Paths, ',', PathsArg)
+    ;   Paths = all
+    ),
+    bench_version(Version),
+    forall(corpus(Kind), macro(Kind, Count, Passes, Paths, Version)).
+
+macro(Kind, Count, Passes, Paths, Version) :-
+    corpus(Kind, 1, Count, Terms),
+    maplist([Term, Bytes]>>phrase(msgpack(Term), Bytes), Terms, Messages),
+    foldl([Message, Size0, Size]>>(length(Message, Length),
+                                   Size is Size0 + Length), Messages, 0, Size),
+    (   maplist([Bytes, Object]>>phrase(msgpack_object(Object), Bytes),
+                Messages, Objects)
+    ->  true
+    ;   Objects = []
+    ),
+    forall(( path(Path, Op, Terms, Messages, Objects, Goal),
+             selected_path(Paths, Path)
+           ),
+           (   passes(Passes, Goal, Best, Median)
+           ->  report(Version, Kind, Path, Op, Count, Size, Best, Median)
+           ;   true
+           )).
+
+%!  path(-Path, -Op, +Terms, +Messages, +Objects, -Goal) is nondet.
+%
+%   Goal encodes or decodes the whole corpus by Path. Paths through
+%   msgpack_object//1 need Objects, absent when some term has no
+%   object form.
+
+path('msgpack//1', encode, Terms, _, _,
+     forall(member(Term, Terms), phrase(msgpack(Term), _))).
+path('msgpack//1', decode, _, Messages, _,
+     forall(member(Bytes, Messages), phrase(msgpack(_), Bytes))).
+path('msgpack_object//1', encode, _, _, Objects,
+     forall(member(Object, Objects), phrase(msgpack_object(Object), _))) :-
+    Objects \== [].
+path('msgpack_object//1', decode, _, Messages, Objects,
+     forall(member(Bytes, Messages), phrase(msgpack_object(_), Bytes))) :-
+    Objects \== [].
+path('msgpack_objects//1', encode, _, _, Objects,
+     phrase(msgpack_objects(Objects), _)) :-
+    Objects \== [].
+path('msgpack_objects//1', decode, _, Messages, Objects,
+     phrase(msgpack_objects(_), Bytes)) :-
+    Objects \== [],
+    append(Messages, Bytes).
+path('msgpack_encode//1', encode, Terms, _, _,
+     forall(member(Term, Terms), phrase(msgpack_encode(Term), _))).
+path('msgpack_decode//1', decode, _, Messages, _,
+     forall(member(Bytes, Messages), phrase(msgpack_decode(_), Bytes))).
+
+selected_path(all, _) :- !.
+selected_path(Paths, Path) :- memberchk(Path, Paths).
+
+%!  passes(+Passes, :Goal, -Best, -Median) is semidet.
+%
+%   Times Passes passes of Goal, answering the fastest and the median
+%   seconds.
+
+passes(Passes, Goal, Best, Median) :-
+    length(Times, Passes),
+    maplist([Time]>>bench_loop(Goal, 1, Time), Times),
+    msort(Times, [Best|Sorted]),
+    Middle is Passes // 2,
+    nth0(Middle, [Best|Sorted], Median).
+
+report(Version, Kind, Path, Op, Count, Size, Seconds, MedianSeconds) :-
+    (   Seconds > 0
+    ->  MegabytesPerSecond is Size / Seconds / 1e6,
+        MessagesPerSecond is Count / Seconds
+    ;   MegabytesPerSecond = null,
+        MessagesPerSecond = null
+    ),
+    (   MedianSeconds > 0
+    ->  MedianMessagesPerSecond is Count / MedianSeconds
+    ;   MedianMessagesPerSecond = null
+    ),
+    bench_report(_{ bench:macro,
+                    version:Version,
+                    corpus:Kind,
+                    path:Path,
+                    op:Op,
+                    messages:Count,
+                    bytes:Size,
+                    seconds:Seconds,
+                    mb_per_s:MegabytesPerSecond,
+                    msgs_per_s:MessagesPerSecond,
+                    median_seconds:MedianSeconds,
+                    median_msgs_per_s:MedianMessagesPerSecond
+                  }).
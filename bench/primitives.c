@@ -0,0 +1,200 @@
+/*  File:    primitives.c
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Microbenchmarks for the MessagePack C primitives
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <SWI-Prolog.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Embeds SWI-Prolog and calls the primitives of c/msgpackc.c directly as C
+functions, without the foreign-predicate call overhead, so that timings
+isolate the endian layer and its list conversions. Each iteration opens
+a foreign frame, calls one primitive and discards the frame, undoing any
+bindings and releasing the global stack that the call used.
+
+Packing binds a number and unifies bytes; unpacking binds bytes and
+unifies a number. Prints one JSON object per line:
+
+    {"bench":"float32/3","mode":"pack","iterations":...,
+     "ns_per_op":...,"global_bytes_per_op":...}
+
+where the last field counts the global-stack bytes of one call, measured
+separately from the timed loop.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+extern int get_list_bytes(term_t Bytes0, term_t Bytes, size_t count, uint8_t *bytes);
+extern int unify_list_bytes(term_t Bytes0, term_t Bytes, size_t count, const uint8_t *bytes);
+
+extern foreign_t float32_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t float64_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t uint16_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t uint32_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t uint64_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t int16_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t int32_3(term_t Number, term_t Bytes0, term_t Bytes);
+extern foreign_t int64_3(term_t Number, term_t Bytes0, term_t Bytes);
+
+static const uint8_t bytes[] = { 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48 };
+
+/*
+ * Arguments shared by all the benchmarks: a number, a list of eight
+ * bytes, and an unbound tail for the bytes left unread or unwritten.
+ */
+static term_t Number, Bytes0, Bytes;
+
+typedef int (*primitive)(term_t Number, term_t Bytes0, term_t Bytes);
+
+struct bench
+{ const char *name;
+  primitive call;
+  int width;
+  int integer;
+};
+
+static const struct bench benches[] =
+{ { "float32/3", float32_3, 4, 0 },
+  { "float64/3", float64_3, 8, 0 },
+  { "uint16/3", uint16_3, 2, 1 },
+  { "uint32/3", uint32_3, 4, 1 },
+  { "uint64/3", uint64_3, 8, 1 },
+  { "int16/3", int16_3, 2, 1 },
+  { "int32/3", int32_3, 4, 1 },
+  { "int64/3", int64_3, 8, 1 },
+  { NULL }
+};
+
+static int64_t
+global_used(void)
+{ static predicate_t statistics;
+  fid_t fid = PL_open_foreign_frame();
+  term_t args = PL_new_term_refs(2);
+  int64_t used = 0;
+  if (!statistics) statistics = PL_predicate("statistics", 2, "system");
+  if (PL_put_atom_chars(args, "globalused") &&
+      PL_call_predicate(NULL, PL_Q_NORMAL, statistics, args))
+    PL_get_int64(args + 1, &used);
+  PL_discard_foreign_frame(fid);
+  return used;
+}
+
+static double
+seconds(void)
+{ struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*
+ * Times one primitive. Setting up the arguments happens once, outside
+ * the loop. The loop only opens, calls and discards.
+ */
+static int
+run(const char *name, const char *mode, primitive call, long iterations)
+{ fid_t fid;
+  int64_t used;
+  double start, elapsed;
+  long iteration;
+  fid = PL_open_foreign_frame();
+  used = global_used();
+  if (!call(Number, Bytes0, Bytes))
+  { fprintf(stderr, "%s %s failed\n", name, mode);
+    return FALSE;
+  }
+  used = global_used() - used;
+  PL_discard_foreign_frame(fid);
+  start = seconds();
+  for (iteration = 0; iteration < iterations; iteration++)
+  { fid = PL_open_foreign_frame();
+    call(Number, Bytes0, Bytes);
+    PL_discard_foreign_frame(fid);
+  }
+  elapsed = seconds() - start;
+  printf("{\"bench\":\"%s\",\"mode\":\"%s\",\"iterations\":%ld,"
+         "\"ns_per_op\":%.2f,\"global_bytes_per_op\":%lld}\n",
+         name, mode, iterations, elapsed * 1e9 / iterations, (long long)used);
+  return TRUE;
+}
+
+/*
+ * The list-byte helpers take the place of a primitive for timing
+ * purposes: eight bytes from or to a list, ignoring the number.
+ */
+static int
+get_list_bytes_3(term_t Number, term_t Bytes0, term_t Bytes)
+{ uint8_t buffer[sizeof(bytes)];
+  (void)Number;
+  return get_list_bytes(Bytes0, Bytes, sizeof(buffer), buffer);
+}
+
+static int
+unify_list_bytes_3(term_t Number, term_t Bytes0, term_t Bytes)
+{ (void)Number;
+  return unify_list_bytes(Bytes0, Bytes, sizeof(bytes), bytes);
+}
+
+int
+main(int argc, char **argv)
+{ char *av[] = { argv[0], "-q", "--no-signals", NULL };
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  const struct bench *bench;
+  term_t Nil;
+  if (!PL_initialise(3, av)) PL_halt(1);
+  Number = PL_new_term_ref();
+  Bytes0 = PL_new_term_ref();
+  Bytes = PL_new_term_ref();
+  Nil = PL_new_term_ref();
+  PL_put_nil(Nil);
+  if (!unify_list_bytes(Bytes0, Nil, sizeof(bytes), bytes)) PL_halt(1);
+  for (bench = benches; bench->name; bench++)
+  { /* Unpacking: bytes bound, number unbound. */
+    PL_put_variable(Number);
+    if (!run(bench->name, "unpack", bench->call, iterations)) PL_halt(1);
+    /* Packing: number bound, bytes unbound. */
+    if (!(bench->integer ? PL_put_int64(Number, 0x4142434445464748 >> ((8 - bench->width) << 3))
+                         : PL_put_float(Number, 1.5))) PL_halt(1);
+    { term_t Bytes1 = PL_copy_term_ref(Bytes0);
+      PL_put_variable(Bytes0);
+      if (!run(bench->name, "pack", bench->call, iterations)) PL_halt(1);
+      PL_put_term(Bytes0, Bytes1);
+    }
+  }
+  PL_put_variable(Number);
+  if (!run("get_list_bytes()", "unpack", get_list_bytes_3, iterations)) PL_halt(1);
+  { term_t Bytes1 = PL_copy_term_ref(Bytes0);
+    PL_put_variable(Bytes0);
+    if (!run("unify_list_bytes()", "pack", unify_list_bytes_3, iterations)) PL_halt(1);
+    PL_put_term(Bytes0, Bytes1);
+  }
+  PL_halt(0);
+  return 0;
+}
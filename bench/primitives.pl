@@ -0,0 +1,77 @@
+/*  File:    primitives.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Microbenchmarks for the MessagePack primitives from Prolog
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(bench).
+
+:- initialization(main, main).
+
+/** <module> Primitive microbenchmarks from Prolog
+
+Times the foreign primitives behind the grammar, packing and unpacking,
+through the usual foreign-predicate call. Compare with the standalone C
+driver in primitives.c, which calls the same primitives without the
+foreign-predicate overhead.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 1 000 000, Iterations),
+    forall(primitive(Name, Mode, Goal),
+           bench_primitive(Name, Mode, Goal, Iterations)).
+
+bench_primitive(Name, Mode, Goal, Iterations) :-
+    bench_loop(Goal, Iterations, Seconds),
+    bench_global(Goal, Bytes),
+    format(atom(Bench), '~q', [Name]),
+    NanosecondsPerOp is Seconds * 1e9 / Iterations,
+    bench_report(_{ bench:Bench,
+                    mode:Mode,
+                    iterations:Iterations,
+                    ns_per_op:NanosecondsPerOp,
+                    global_bytes_per_op:Bytes
+                  }).
+
+primitive(Name/3, unpack, msgpackc:Goal) :-
+    width(Name, Width, _),
+    length(Bytes, Width),
+    append(Bytes, _, [0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48]),
+    Goal =.. [Name, _, Bytes, []].
+primitive(Name/3, pack, msgpackc:Goal) :-
+    width(Name, _, Number),
+    Goal =.. [Name, Number, _, []].
+
+width(float32, 4, 1.5).
+width(float64, 8, 1.5).
+width(uint16, 2, 0x4142).
+width(uint32, 4, 0x41424344).
+width(uint64, 8, 0x4142434445464748).
+width(int16, 2, 0x4142).
+width(int32, 4, 0x41424344).
+width(int64, 8, 0x4142434445464748).
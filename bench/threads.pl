@@ -0,0 +1,169 @@
+/*  File:    threads.pl
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: Multi-thread scaling benchmarks for MessagePack
+
+Copyright (c) 2026, msgpackc contributors
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+:- use_module(library(main)).
+:- use_module(library(msgpackc)).
+:- use_module(bench).
+:- use_module(corpus).
+
+:- initialization(main, main).
+
+/** <module> Thread scaling benchmarks
+
+Decodes and encodes the same corpus concurrently on 1, 2, 4 and so on
+up to N threads, where each thread processes the whole corpus. Perfect
+scaling multiplies throughput by the thread count. Shared resources
+serialise threads and show up as lower efficiency: the throughput
+relative to one thread, divided by the thread count. Efficiency below
+0.7 flags sub-linear scaling.
+
+CPU utilisation sums the CPU time of the threads, divided by the thread
+count and the wall-clock time. Threads blocked on locks burn no CPU, so
+low utilisation alongside low efficiency points at contention rather
+than at memory bandwidth. The telemetry corpus exercises the atom table
+by way of msgpack_object//1 map keys.
+
+Arguments: messages per corpus, default 200; maximum threads, default
+the CPU count. Lock statistics follow the scaling reports if the
+SWI-Prolog build collects them.
+
+*/
+
+main(Argv) :-
+    bench_iterations(Argv, 200, Count),
+    (   Argv = [_, Arg|_],
+        atom_number(Arg, MaxThreads)
+    ->  true
+    ;   current_prolog_flag(cpu_count, MaxThreads)
+    ),
+    bench_version(Version),
+    corpus(telemetry, 1, Count, Terms),
+    maplist([Term, Bytes]>>phrase(msgpack(Term), Bytes), Terms, Messages),
+    forall(path(Path, Op, Terms, Messages, Goal),
+           scaling(Version, Path, Op, Count, MaxThreads, Goal)),
+    contention(Version).
+
+path('msgpack//1', decode, _, Messages,
+     forall(member(Bytes, Messages), phrase(msgpack(_), Bytes))).
+path('msgpack_object//1', decode, _, Messages,
+     forall(member(Bytes, Messages), phrase(msgpack_object(_), Bytes))).
+path('msgpack_decode//1', decode, _, Messages,
+     forall(member(Bytes, Messages), phrase(msgpack_decode(_), Bytes))).
+path('msgpack//1', encode, Terms, _,
+     forall(member(Term, Terms), phrase(msgpack(Term), _))).
+path('msgpack_encode//1', encode, Terms, _,
+     forall(member(Term, Terms), phrase(msgpack_encode(Term), _))).
+
+scaling(Version, Path, Op, Count, MaxThreads, Goal) :-
+    thread_counts(MaxThreads, ThreadCounts),
+    foldl(scaling(Version, Path, Op, Count, Goal), ThreadCounts, _, _).
+
+scaling(Version, Path, Op, Count, Goal, Threads, Single0, Single) :-
+    run(Threads, Goal, Seconds, Cpu),
+    MessagesPerSecond is Threads * Count / Seconds,
+    (   var(Single0)
+    ->  Single = MessagesPerSecond
+    ;   Single = Single0
+    ),
+    Efficiency is MessagesPerSecond / (Threads * Single),
+    Utilisation is Cpu / (Threads * Seconds),
+    (   Efficiency < 0.7
+    ->  Sublinear = true
+    ;   Sublinear = false
+    ),
+    bench_report(_{ bench:threads,
+                    version:Version,
+                    corpus:telemetry,
+                    path:Path,
+                    op:Op,
+                    threads:Threads,
+                    messages:Count,
+                    seconds:Seconds,
+                    msgs_per_s:MessagesPerSecond,
+                    efficiency:Efficiency,
+                    cpu_utilisation:Utilisation,
+                    sublinear:Sublinear
+                  }).
+
+%!  thread_counts(+Max, -Counts) is det.
+%
+%   Powers of two below Max, then Max itself.
+
+thread_counts(Max, Counts) :-
+    findall(Count,
+            (   between(0, 16, Power),
+                Count is 1 << Power,
+                Count < Max
+            ;   Count = Max
+            ), Counts).
+
+%!  run(+Threads, :Goal, -Seconds, -Cpu) is det.
+%
+%   Runs Goal once in each of Threads threads, all released at once
+%   through a gate once created. Seconds is the wall-clock time from
+%   release to the last thread finishing; Cpu sums the CPU time of all
+%   the threads.
+
+run(Threads, Goal, Seconds, Cpu) :-
+    message_queue_create(Gate),
+    message_queue_create(Results),
+    length(Ids, Threads),
+    maplist([Id]>>thread_create(worker(Gate, Results, Goal), Id, []), Ids),
+    get_time(Start),
+    forall(member(_, Ids), thread_send_message(Gate, go)),
+    maplist([Id]>>thread_join(Id, true), Ids),
+    get_time(End),
+    length(Times, Threads),
+    maplist(thread_get_message(Results), Times),
+    sum_list(Times, Cpu),
+    message_queue_destroy(Gate),
+    message_queue_destroy(Results),
+    Seconds is End - Start.
+
+worker(Gate, Results, Goal) :-
+    thread_get_message(Gate, go),
+    statistics(cputime, Time0),
+    call(Goal),
+    statistics(cputime, Time1),
+    Time is Time1 - Time0,
+    thread_send_message(Results, Time).
+
+%!  contention(+Version) is det.
+%
+%   Reports lock statistics as text, if any. Only builds of SWI-Prolog
+%   compiled with contention statistics print them.
+
+contention(Version) :-
+    (   catch(with_output_to(string(Mutexes), mutex_statistics), _, fail),
+        Mutexes \== ""
+    ->  bench_report(_{ bench:contention,
+                        version:Version,
+                        mutexes:Mutexes
+                      })
+    ;   true
+    ).
@@ -26,6 +26,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
+#ifdef MSGPACKC_GMP
+#include <gmp.h>
+#endif
+
 #include <SWI-Prolog.h>
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -42,7 +46,20 @@ a note for the direct dependency.
 
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#ifdef MSGPACKC_STATISTICS
+#include <time.h>
+#endif
+
+#ifdef MSGPACKC_USDT
+#include <sys/sdt.h>
+#endif
 
 /*
  * Gets a list of bytes from a list of byte codes by byte count. Fails
@@ -158,10 +175,10 @@ union xxxxxxxx
 
 /*
  * Performs the C equivalent of a C++ reinterpret cast from 32-bit
- * unsigned integer to 32-bit float. Temporarily takes the address of a
- * stack-passed integer, recasts the pointer's target and indirects to
- * the recasting. The compiler optimiser obviates all the indirection.
- * The result is just a register-register move operation.
+ * unsigned integer to 32-bit float. Copies the bits with memcpy() rather
+ * than indirecting through a recast pointer, which would break the
+ * strict-aliasing rules. The compiler optimiser obviates the copy. The
+ * result is just a register-register move operation.
  *
  * 66 0f 6e c1          movd   %ecx,%xmm0
  * c3                   ret
@@ -172,22 +189,30 @@ union xxxxxxxx
  */
 float
 reinterpret_to_float32(uint32_t xxxx)
-{ return *(float *)&xxxx;
+{ float value;
+  memcpy(&value, &xxxx, sizeof(value));
+  return value;
 }
 
 uint32_t
 reinterpret_from_float32(float xxxx)
-{ return *(uint32_t *)&xxxx;
+{ uint32_t value;
+  memcpy(&value, &xxxx, sizeof(value));
+  return value;
 }
 
 double
 reinterpret_to_float64(uint64_t xxxxxxxx)
-{ return *(double *)&xxxxxxxx;
+{ double value;
+  memcpy(&value, &xxxxxxxx, sizeof(value));
+  return value;
 }
 
 uint64_t
 reinterpret_from_float64(double xxxxxxxx)
-{ return *(uint64_t *)&xxxxxxxx;
+{ uint64_t value;
+  memcpy(&value, &xxxxxxxx, sizeof(value));
+  return value;
 }
 
 foreign_t
@@ -302,8 +327,2796 @@ int64_3(term_t Number, term_t Bytes0, term_t Bytes)
   }
 }
 
-install_t install_msgpackc()
-{ PL_register_foreign("float32", 3, float32_3, 0);
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+The C decoder reads one msgpack//1 term from a list of byte codes. It
+mirrors the grammar but never back-tracks. The lead byte selects the
+format; the header that follows fixes every length up front. That
+makes the header the cheapest place to enforce decoding budgets: a map
+that claims four thousand million pairs fails on its first five bytes
+rather than after building four thousand million pair cells.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static atom_t ATOM_nil;
+static atom_t ATOM_false;
+static atom_t ATOM_true;
+static atom_t ATOM_max_depth;
+static atom_t ATOM_max_elements;
+static atom_t ATOM_max_str_bytes;
+static atom_t ATOM_max_total_bytes;
+static atom_t ATOM_strict;
+static atom_t ATOM_timestamp;
+static atom_t ATOM_epoch;
+static atom_t ATOM_sec_nsec;
+static atom_t ATOM_share;
+
+static functor_t FUNCTOR_bool1;
+static functor_t FUNCTOR_int1;
+static functor_t FUNCTOR_float1;
+static functor_t FUNCTOR_str1;
+static functor_t FUNCTOR_bin1;
+static functor_t FUNCTOR_array1;
+static functor_t FUNCTOR_map1;
+static functor_t FUNCTOR_minus2;
+static functor_t FUNCTOR_divide2;
+static functor_t FUNCTOR_timestamp1;
+static functor_t FUNCTOR_timestamp2;
+static functor_t FUNCTOR_term1;
+static functor_t FUNCTOR_msgpackc_var2;
+
+static predicate_t PREDICATE_ext_dispatch3;
+
+/*
+ * Decoding budget. Every limit defaults to the largest size so that
+ * an unconfigured decoder never refuses a well-formed message.
+ *
+ * Depth counts nested arrays and maps; a scalar has depth zero.
+ * Elements counts every object decoded including the containers
+ * themselves, where each map pair counts as two. String bytes limit
+ * the payload of any one str, bin or ext object. Total bytes limit
+ * the length of the entire message.
+ *
+ * Strict decoding raises a syntax error for malformed input where
+ * lenient decoding simply fails.
+ *
+ * Sharing, when enabled, reserves one ext type for back-references to
+ * earlier objects of the same message; see below.
+ */
+struct options
+{ size_t max_depth;
+  size_t max_elements;
+  size_t max_str_bytes;
+  size_t max_total_bytes;
+  int strict;
+  int sec_nsec;
+  int share;
+  int8_t share_type;
+};
+
+static void
+init_options(struct options *options)
+{ options->max_depth = SIZE_MAX;
+  options->max_elements = SIZE_MAX;
+  options->max_str_bytes = SIZE_MAX;
+  options->max_total_bytes = SIZE_MAX;
+  options->strict = FALSE;
+  options->sec_nsec = FALSE;
+  options->share = FALSE;
+  options->share_type = 0;
+}
+
+static int
+parse_options(term_t Options, struct options *options)
+{ term_t Tail = PL_copy_term_ref(Options);
+  term_t Option = PL_new_term_ref();
+  term_t Value = PL_new_term_ref();
+  init_options(options);
+  while (PL_get_list(Tail, Option, Tail))
+  { atom_t name;
+    size_t arity;
+    size_t *limit;
+    if (!PL_get_name_arity(Option, &name, &arity) || arity != 1) continue;
+    if (name == ATOM_max_depth) limit = &options->max_depth;
+    else if (name == ATOM_max_elements) limit = &options->max_elements;
+    else if (name == ATOM_max_str_bytes) limit = &options->max_str_bytes;
+    else if (name == ATOM_max_total_bytes) limit = &options->max_total_bytes;
+    else if (name == ATOM_strict)
+    { if (!PL_get_arg(1, Option, Value) || !PL_get_bool_ex(Value, &options->strict)) PL_fail;
+      continue;
+    } else if (name == ATOM_timestamp)
+    { atom_t form;
+      if (!PL_get_arg(1, Option, Value) || !PL_get_atom_ex(Value, &form)) PL_fail;
+      if (form == ATOM_sec_nsec) options->sec_nsec = TRUE;
+      else if (form == ATOM_epoch) options->sec_nsec = FALSE;
+      else return PL_domain_error("msgpack_timestamp", Value);
+      continue;
+    } else if (name == ATOM_share)
+    { int type;
+      if (!PL_get_arg(1, Option, Value) || !PL_get_integer_ex(Value, &type)) PL_fail;
+      if (type < INT8_MIN || type > INT8_MAX) return PL_domain_error("msgpack_ext_type", Value);
+      options->share = TRUE;
+      options->share_type = type;
+      continue;
+    } else continue;
+    if (!PL_get_arg(1, Option, Value) || !PL_get_size_ex(Value, limit)) PL_fail;
+  }
+  return PL_get_nil_ex(Tail);
+}
+
+/*
+ * A codec blob captures options already parsed. Predicates that accept
+ * Options accept a codec in place of a list, and then skip parsing
+ * altogether. Codecs never change once created, so threads can share
+ * them freely.
+ */
+struct codec
+{ struct options options;
+};
+
+static int
+release_codec(atom_t Codec)
+{ free(*(struct codec **)PL_blob_data(Codec, NULL, NULL));
+  PL_succeed;
+}
+
+static PL_blob_t codec_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_NOCOPY|PL_BLOB_UNIQUE,
+  "msgpack_codec",
+  release_codec,
+};
+
+/*
+ * Points options at the options of a codec, else parses an option list
+ * into the given space and points at that instead.
+ */
+static int
+get_options(term_t Options, struct options *parsed, const struct options **options)
+{ void *data;
+  PL_blob_t *type;
+  if (PL_get_blob(Options, &data, NULL, &type) && type == &codec_blob)
+  { *options = &(*(struct codec **)data)->options;
+    PL_succeed;
+  }
+  *options = parsed;
+  return parse_options(Options, parsed);
+}
+
+foreign_t
+msgpack_codec_create_2(term_t Options, term_t Codec)
+{ struct codec *codec;
+  if (!(codec = malloc(sizeof(*codec)))) return PL_resource_error("memory");
+  if (!parse_options(Options, &codec->options))
+  { free(codec);
+    PL_fail;
+  }
+  return PL_unify_blob(Codec, &codec, sizeof(codec), &codec_blob);
+}
+
+/*
+ * Raises error(resource_error(msgpack_budget(Budget, Limit)), _) where
+ * Budget names the option that the message exceeded.
+ */
+static int
+budget_error(const char *budget, size_t limit)
+{ term_t Error = PL_new_term_ref();
+  return PL_unify_term(Error,
+                       PL_FUNCTOR_CHARS, "error", 2,
+                         PL_FUNCTOR_CHARS, "resource_error", 1,
+                           PL_FUNCTOR_CHARS, "msgpack_budget", 2,
+                             PL_CHARS, budget,
+                             PL_INT64, (int64_t)limit,
+                         PL_VARIABLE) && PL_raise_exception(Error);
+}
+
+/*
+ * Raises error(syntax_error(msgpack(Reason, Offset)), _) where Offset
+ * counts bytes from the start of the message.
+ */
+static int
+syntax_error(const char *reason, size_t offset)
+{ term_t Error = PL_new_term_ref();
+  return PL_unify_term(Error,
+                       PL_FUNCTOR_CHARS, "error", 2,
+                         PL_FUNCTOR_CHARS, "syntax_error", 1,
+                           PL_FUNCTOR_CHARS, "msgpack", 2,
+                             PL_CHARS, reason,
+                             PL_INT64, (int64_t)offset,
+                         PL_VARIABLE) && PL_raise_exception(Error);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Statistics count objects and payload bytes by format, separately for
+decoding and encoding. Each thread counts into its own block using
+plain relaxed stores, no locks and no atomic read-modify-write. Only
+thread start, thread exit and the query take a mutex, in order to link,
+fold and sum the blocks. Counts from exited threads fold into a retired
+block. Resetting snapshots a baseline rather than writing to the blocks
+of other threads.
+
+Latency histograms record the wall-clock duration of each message
+decoded or encoded, by direction and by message size class. Buckets are
+log-linear after the fashion of HDR histograms: eight sub-buckets for
+every power of two, hence a worst-case error of one eighth from 8ns up
+to the full 64-bit range. Size classes go up in powers of four from
+below 16 bytes to 64KiB and above.
+
+Compile with MSGPACKC_STATISTICS defined to enable. Otherwise the
+counting macros expand to nothing.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+enum direction
+{ DECODING,
+  ENCODING,
+  DIRECTIONS
+};
+
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+#define SIZE_CLASSES 8
+
+#ifdef MSGPACKC_STATISTICS
+
+struct counters
+{ uint64_t objects[DIRECTIONS][256];
+  uint64_t bytes[DIRECTIONS][256];
+  uint64_t latency[DIRECTIONS][SIZE_CLASSES][LATENCY_BUCKETS];
+  uint64_t allocated;
+};
+
+struct statistics
+{ struct counters counters;
+  struct statistics *next;
+};
+
+static __thread struct statistics *thread_statistics;
+static struct statistics *all_statistics;
+static struct statistics retired_statistics;
+static struct statistics baseline_statistics;
+static pthread_mutex_t statistics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t statistics_key;
+
+/*
+ * Adds or subtracts, depending on sign, all the counters of one block
+ * to those of another. The counters form one flat array of 64-bit
+ * words.
+ */
+static void
+fold_statistics(struct statistics *into, const struct statistics *from, int sign)
+{ uint64_t *to = (uint64_t *)&into->counters;
+  const uint64_t *counters = (const uint64_t *)&from->counters;
+  size_t index;
+  for (index = 0; index < sizeof(struct counters) / sizeof(uint64_t); index++)
+    to[index] += sign * __atomic_load_n(counters + index, __ATOMIC_RELAXED);
+}
+
+/*
+ * Folds the counts of an exiting thread into the retired block, then
+ * unlinks and frees its block.
+ */
+static void
+release_statistics(void *data)
+{ struct statistics *statistics = data, **link;
+  pthread_mutex_lock(&statistics_mutex);
+  fold_statistics(&retired_statistics, statistics, 1);
+  for (link = &all_statistics; *link; link = &(*link)->next)
+    if (*link == statistics)
+    { *link = statistics->next;
+      break;
+    }
+  pthread_mutex_unlock(&statistics_mutex);
+  free(statistics);
+}
+
+static struct statistics *
+new_statistics(void)
+{ struct statistics *statistics;
+  if (!(statistics = calloc(1, sizeof(*statistics)))) return NULL;
+  pthread_mutex_lock(&statistics_mutex);
+  statistics->next = all_statistics;
+  all_statistics = statistics;
+  pthread_mutex_unlock(&statistics_mutex);
+  pthread_setspecific(statistics_key, statistics);
+  return thread_statistics = statistics;
+}
+
+static inline void
+count_statistics(uint64_t *counter, uint64_t count)
+{ __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + count, __ATOMIC_RELAXED);
+}
+
+static inline void
+count_objects(enum direction direction, uint8_t format)
+{ struct statistics *statistics = thread_statistics;
+  if (statistics || (statistics = new_statistics()))
+    count_statistics(&statistics->counters.objects[direction][format], 1);
+}
+
+static inline void
+count_bytes(enum direction direction, uint8_t format, size_t count)
+{ struct statistics *statistics = thread_statistics;
+  if (statistics || (statistics = new_statistics()))
+    count_statistics(&statistics->counters.bytes[direction][format], count);
+}
+
+static inline uint64_t
+nanoseconds(void)
+{ struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static size_t
+latency_bucket(uint64_t value)
+{ int msb;
+  if (value < LATENCY_SUB_BUCKETS) return value;
+  msb = 63 - __builtin_clzll(value);
+  return ((msb - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) +
+         ((value >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+static size_t
+size_class(size_t size)
+{ int msb;
+  if (size < 16) return 0;
+  msb = 63 - __builtin_clzll(size);
+  return msb >= 16 ? SIZE_CLASSES - 1 : (msb - 2) / 2;
+}
+
+static void
+count_latency(enum direction direction, uint64_t started, size_t size)
+{ struct statistics *statistics = thread_statistics;
+  if (statistics || (statistics = new_statistics()))
+    count_statistics(&statistics->counters.latency[direction][size_class(size)]
+                                                  [latency_bucket(nanoseconds() - started)], 1);
+}
+
+static inline void
+count_allocated(size_t count)
+{ struct statistics *statistics = thread_statistics;
+  if (statistics || (statistics = new_statistics()))
+    count_statistics(&statistics->counters.allocated, count);
+}
+
+/*
+ * Sums the blocks of all threads, living and retired.
+ */
+static void
+sum_statistics(struct statistics *sum)
+{ struct statistics *statistics;
+  memset(sum, 0, sizeof(*sum));
+  fold_statistics(sum, &retired_statistics, 1);
+  for (statistics = all_statistics; statistics; statistics = statistics->next)
+    fold_statistics(sum, statistics, 1);
+}
+
+#define COUNT_OBJECTS(direction, format) count_objects(direction, format)
+#define COUNT_BYTES(direction, format, count) count_bytes(direction, format, count)
+#define START_LATENCY() nanoseconds()
+#define COUNT_LATENCY(direction, started, size) count_latency(direction, started, size)
+#define COUNT_ALLOCATED(count) count_allocated(count)
+
+#else
+
+#define COUNT_OBJECTS(direction, format) ((void)0)
+#define COUNT_BYTES(direction, format, count) ((void)0)
+#define START_LATENCY() 0
+#define COUNT_LATENCY(direction, started, size) ((void)(started), (void)(size))
+#define COUNT_ALLOCATED(count) ((void)0)
+
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Static tracepoints for perf, bpftrace and SystemTap under provider
+msgpackc. Direction arguments are zero for decoding and one for
+encoding. Offsets count bytes from the start of the input list when
+decoding, or of the output when encoding.
+
+    message_start(direction, offset)
+    message_end(direction, offset, size)
+    container_open(direction, offset, format, length, depth)
+    container_close(direction, offset, depth)
+    alloc(what, bytes)
+
+The alloc probe fires whenever a reader, stack or writer moves to or
+grows on the heap; its first argument is a C string. Compile with
+MSGPACKC_USDT defined to enable, else the probes vanish. Each probe
+costs one no-op instruction when nothing traces it.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef MSGPACKC_USDT
+#define PROBE2(name, a, b) DTRACE_PROBE2(msgpackc, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(msgpackc, name, a, b, c)
+#define PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(msgpackc, name, a, b, c, d, e)
+#else
+#define PROBE2(name, a, b) ((void)0)
+#define PROBE3(name, a, b, c) ((void)0)
+#define PROBE5(name, a, b, c, d, e) ((void)0)
+#endif
+
+/*
+ * The writer lives in the public header, shared with other C libraries.
+ * Its hooks feed the statistics and tracepoints of the foreign library.
+ */
+#define MSGPACKC_WROTE_FORMAT(writer, format) COUNT_OBJECTS(ENCODING, format)
+#define MSGPACKC_WROTE_DATA(writer, count) COUNT_BYTES(ENCODING, (writer)->format, count)
+#define MSGPACKC_ALLOCATED(writer, capacity) \
+  do { PROBE2(alloc, "writer", capacity); COUNT_ALLOCATED(capacity); } while (0)
+
+#include "msgpackc.h"
+
+#ifdef MSGPACKC_STATISTICS
+
+/*
+ * Format families by lead byte. The fixed formats span ranges of lead
+ * bytes; every other lead byte from 0xc0 through 0xdf has a family of
+ * its own.
+ */
+static const char *family_names[] =
+{ "fixint", "fixmap", "fixarray", "fixstr",
+  "nil", "never_used", "false", "true",
+  "bin8", "bin16", "bin32",
+  "ext8", "ext16", "ext32",
+  "float32", "float64",
+  "uint8", "uint16", "uint32", "uint64",
+  "int8", "int16", "int32", "int64",
+  "fixext1", "fixext2", "fixext4", "fixext8", "fixext16",
+  "str8", "str16", "str32",
+  "array16", "array32",
+  "map16", "map32"
+};
+
+#define FAMILIES (sizeof(family_names) / sizeof(family_names[0]))
+
+static size_t
+family(uint8_t format)
+{ if (format <= 0x7f || format >= 0xe0) return 0;
+  if (format <= 0x8f) return 1;
+  if (format <= 0x9f) return 2;
+  if (format <= 0xbf) return 3;
+  return 4 + format - 0xc0;
+}
+
+#endif
+
+/*
+ * msgpack_statistics(-Stats)
+ *
+ * Unifies Stats with a list of decode(Family, Objects, Bytes) and
+ * encode(Family, Objects, Bytes) terms for every family with non-zero
+ * objects since the last reset. Bytes counts payload bytes for the str,
+ * bin and ext families. Unifies with the empty list when compiled
+ * without statistics.
+ */
+foreign_t
+msgpack_statistics_1(term_t Stats)
+{ term_t Tail = PL_copy_term_ref(Stats);
+#ifdef MSGPACKC_STATISTICS
+  term_t Head = PL_new_term_ref();
+  static const char *direction_names[] = { "decode", "encode" };
+  uint64_t objects[DIRECTIONS][FAMILIES] = { { 0 } }, bytes[DIRECTIONS][FAMILIES] = { { 0 } };
+  struct statistics *sum;
+  int direction, format;
+  size_t index;
+  if (!(sum = malloc(sizeof(*sum)))) return PL_resource_error("memory");
+  pthread_mutex_lock(&statistics_mutex);
+  sum_statistics(sum);
+  fold_statistics(sum, &baseline_statistics, -1);
+  pthread_mutex_unlock(&statistics_mutex);
+  for (direction = 0; direction < DIRECTIONS; direction++)
+    for (format = 0; format < 256; format++)
+    { objects[direction][family(format)] += sum->counters.objects[direction][format];
+      bytes[direction][family(format)] += sum->counters.bytes[direction][format];
+    }
+  free(sum);
+  for (direction = 0; direction < DIRECTIONS; direction++)
+    for (index = 0; index < FAMILIES; index++)
+      if (objects[direction][index] &&
+          !(PL_unify_list(Tail, Head, Tail) &&
+            PL_unify_term(Head,
+                          PL_FUNCTOR_CHARS, direction_names[direction], 3,
+                            PL_CHARS, family_names[index],
+                            PL_INT64, (int64_t)objects[direction][index],
+                            PL_INT64, (int64_t)bytes[direction][index]))) PL_fail;
+#endif
+  return PL_unify_nil(Tail);
+}
+
+/*
+ * msgpack_latency(-Histograms)
+ *
+ * Unifies Histograms with a list of latency(Direction, Below,
+ * Histogram) terms, one for each direction and size class with at
+ * least one message, where Below is the exclusive upper bound of the
+ * size class in bytes or the atom inf for the last class. Histogram
+ * lists Nanoseconds-Count pairs in ascending order, one for each
+ * non-empty bucket, where Nanoseconds is the lower bound of the
+ * bucket.
+ */
+foreign_t
+msgpack_latency_1(term_t Histograms)
+{ term_t Tail = PL_copy_term_ref(Histograms);
+#ifdef MSGPACKC_STATISTICS
+  term_t Head = PL_new_term_ref(), Histogram = PL_new_term_ref();
+  term_t Buckets = PL_new_term_ref(), Bucket = PL_new_term_ref();
+  static const char *direction_names[] = { "decode", "encode" };
+  struct statistics *sum;
+  int direction;
+  size_t class, index;
+  if (!(sum = malloc(sizeof(*sum)))) return PL_resource_error("memory");
+  pthread_mutex_lock(&statistics_mutex);
+  sum_statistics(sum);
+  fold_statistics(sum, &baseline_statistics, -1);
+  pthread_mutex_unlock(&statistics_mutex);
+  for (direction = 0; direction < DIRECTIONS; direction++)
+    for (class = 0; class < SIZE_CLASSES; class++)
+    { const uint64_t *latency = sum->counters.latency[direction][class];
+      int rc = TRUE, empty = TRUE;
+      for (index = 0; index < LATENCY_BUCKETS && empty; index++)
+        if (latency[index]) empty = FALSE;
+      if (empty) continue;
+      PL_put_variable(Histogram);
+      if (!PL_unify_list(Tail, Head, Tail)) rc = FALSE;
+      else if (class == SIZE_CLASSES - 1)
+        rc = PL_unify_term(Head,
+                           PL_FUNCTOR_CHARS, "latency", 3,
+                             PL_CHARS, direction_names[direction],
+                             PL_CHARS, "inf",
+                             PL_TERM, Histogram);
+      else
+        rc = PL_unify_term(Head,
+                           PL_FUNCTOR_CHARS, "latency", 3,
+                             PL_CHARS, direction_names[direction],
+                             PL_INT64, (int64_t)1 << ((class + 2) << 1),
+                             PL_TERM, Histogram);
+      PL_put_term(Buckets, Histogram);
+      for (index = 0; rc && index < LATENCY_BUCKETS; index++)
+      { uint64_t lower;
+        if (latency[index] == 0) continue;
+        if (index < LATENCY_SUB_BUCKETS) lower = index;
+        else
+        { size_t shift = (index >> LATENCY_SUB_BITS) - 1;
+          lower = (uint64_t)(LATENCY_SUB_BUCKETS + (index & (LATENCY_SUB_BUCKETS - 1))) << shift;
+        }
+        rc = PL_unify_list(Buckets, Bucket, Buckets) &&
+             PL_unify_term(Bucket,
+                           PL_FUNCTOR_CHARS, "-", 2,
+                             PL_INT64, (int64_t)lower,
+                             PL_INT64, (int64_t)latency[index]);
+      }
+      if (!rc || !PL_unify_nil(Buckets))
+      { free(sum);
+        PL_fail;
+      }
+    }
+  free(sum);
+#endif
+  return PL_unify_nil(Tail);
+}
+
+/*
+ * msgpack_thread_allocated(-Bytes)
+ *
+ * Unifies Bytes with the total heap bytes allocated by the codec in the
+ * calling thread since it started, ignoring resets. Counts the new
+ * capacity of every growing reader, stack or writer, and every buffer.
+ * Differences between two calls give the bytes allocated in between.
+ * Always zero without statistics.
+ */
+foreign_t
+msgpack_thread_allocated_1(term_t Bytes)
+{
+#ifdef MSGPACKC_STATISTICS
+  struct statistics *statistics = thread_statistics;
+  if (statistics) return PL_unify_uint64(Bytes, statistics->counters.allocated);
+#endif
+  return PL_unify_uint64(Bytes, 0);
+}
+
+foreign_t
+msgpack_reset_statistics_0(void)
+{
+#ifdef MSGPACKC_STATISTICS
+  pthread_mutex_lock(&statistics_mutex);
+  sum_statistics(&baseline_statistics);
+  pthread_mutex_unlock(&statistics_mutex);
+#endif
+  PL_succeed;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+The ext registry maps each of the 256 ext type bytes to a codec, either
+native C callbacks registered by foreign libraries through
+msgpackc_register_ext() or a Prolog closure registered by
+msgpack_register_ext/3. Decoding indexes the table by type byte.
+Encoding matches the functor of a term against the registered types.
+Types without a codec fall back to msgpack:type_ext_hook/3.
+
+Register at load time. Registration takes a lock but encoding and
+decoding read the table without one.
+
+Native codecs built into this library may also decode within the
+budgets of the decoder that meets them, by way of a bounded decode
+callback in place of the public one.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+struct decoder;
+
+struct ext
+{ struct msgpackc_ext_codec codec;
+  int (*decode_bounded)(struct decoder *decoder, term_t Term, const uint8_t *bytes, size_t length);
+  predicate_t predicate;
+  int registered;
+};
+
+static struct ext exts[256];
+static uint8_t ext_types[256];
+static size_t ext_count;
+static pthread_mutex_t ext_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+register_ext(int8_t type, const struct msgpackc_ext_codec *codec,
+             int (*decode_bounded)(struct decoder *, term_t, const uint8_t *, size_t),
+             predicate_t predicate)
+{ struct ext *ext = exts + (uint8_t)type;
+  pthread_mutex_lock(&ext_mutex);
+  ext->codec = *codec;
+  ext->decode_bounded = decode_bounded;
+  ext->predicate = predicate;
+  if (!ext->registered) ext_types[ext_count++] = type;
+  __atomic_store_n(&ext->registered, TRUE, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&ext_mutex);
+}
+
+int
+msgpackc_register_ext(int8_t type, const struct msgpackc_ext_codec *codec)
+{ if (codec->encode == NULL || codec->decode == NULL) return FALSE;
+  register_ext(type, codec, NULL, NULL);
+  return TRUE;
+}
+
+static const struct ext *
+get_ext(uint8_t type)
+{ const struct ext *ext = exts + type;
+  return __atomic_load_n(&ext->registered, __ATOMIC_ACQUIRE) ? ext : NULL;
+}
+
+/*
+ * Finds the ext type registered for the functor of Term, if any.
+ */
+static const struct ext *
+find_ext(term_t Term, int8_t *type)
+{ functor_t functor;
+  size_t index, count = __atomic_load_n(&ext_count, __ATOMIC_ACQUIRE);
+  if (count == 0 || !PL_get_functor(Term, &functor)) return NULL;
+  for (index = 0; index < count; index++)
+  { const struct ext *ext = exts + ext_types[index];
+    if (ext->codec.functor == functor)
+    { *type = ext_types[index];
+      return ext;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * register_ext(+Type, +Name/Arity, +Module:Closure)
+ *
+ * Registers a Prolog closure as the codec for Type, called as
+ * call(Closure, Term, Bytes) in both directions. The closure must be an
+ * atom naming a predicate of arity two; msgpack_register_ext/3 checks
+ * and qualifies it.
+ */
+static foreign_t
+register_ext_3(term_t Type, term_t Functor, term_t Closure)
+{ struct msgpackc_ext_codec codec = { 0 };
+  term_t Name = PL_new_term_ref(), Arity = PL_new_term_ref(), Plain = PL_new_term_ref();
+  module_t module = NULL;
+  atom_t name, closure;
+  int type;
+  size_t arity;
+  if (!PL_get_integer_ex(Type, &type)) PL_fail;
+  if (type < INT8_MIN || type > INT8_MAX) return PL_domain_error("msgpack_ext_type", Type);
+  if (!PL_is_functor(Functor, FUNCTOR_divide2) ||
+      !PL_get_arg(1, Functor, Name) || !PL_get_arg(2, Functor, Arity))
+    return PL_type_error("predicate_indicator", Functor);
+  if (!PL_get_atom_ex(Name, &name) || !PL_get_size_ex(Arity, &arity) ||
+      !PL_strip_module(Closure, &module, Plain) ||
+      !PL_get_atom_ex(Plain, &closure)) PL_fail;
+  codec.functor = PL_new_functor(name, arity);
+  register_ext(type, &codec, NULL, PL_pred(PL_new_functor(closure, 2), module));
+  PL_succeed;
+}
+
+/*
+ * Pulls bytes from a list of byte codes on demand, only as many as the
+ * decoder asks for. The list tail left behind therefore always begins
+ * at the first unread byte, ready for unifying with the remainder of a
+ * grammar phrase.
+ *
+ * The scratch buffer grows while bytes actually arrive rather than
+ * trusting the requested count up front. A hostile length prefix
+ * cannot make the reader allocate much more than the bytes really
+ * present in the list.
+ */
+struct reader
+{ term_t tail;
+  term_t byte;
+  size_t offset;
+  const char *error;
+  uint8_t *bytes;
+  size_t capacity;
+  uint8_t buffer[256];
+};
+
+static void
+init_reader(struct reader *reader, term_t Bytes0)
+{ reader->tail = PL_copy_term_ref(Bytes0);
+  reader->byte = PL_new_term_ref();
+  reader->offset = 0;
+  reader->error = NULL;
+  reader->bytes = reader->buffer;
+  reader->capacity = sizeof(reader->buffer);
+}
+
+static void
+release_reader(struct reader *reader)
+{ if (reader->bytes != reader->buffer) free(reader->bytes);
+}
+
+static int
+grow_reader(struct reader *reader)
+{ size_t capacity = reader->capacity << 1;
+  uint8_t *bytes;
+  if (reader->bytes == reader->buffer)
+  { if ((bytes = malloc(capacity))) memcpy(bytes, reader->buffer, reader->capacity);
+  } else bytes = realloc(reader->bytes, capacity);
+  if (bytes == NULL) return PL_resource_error("memory");
+  PROBE2(alloc, "reader", capacity);
+  COUNT_ALLOCATED(capacity);
+  reader->bytes = bytes;
+  reader->capacity = capacity;
+  return TRUE;
+}
+
+/*
+ * Answers NULL when the list runs out before count bytes or when an
+ * element is not a byte, zero through 255 inclusive. Either way, the
+ * reader notes the reason and advances its offset to the failing
+ * element.
+ */
+static const uint8_t *
+read_bytes(struct reader *reader, size_t count)
+{ size_t index;
+  for (index = 0; index < count; index++)
+  { int value;
+    if (index == reader->capacity && !grow_reader(reader)) return NULL;
+    if (!PL_get_list(reader->tail, reader->byte, reader->tail))
+    { reader->error = "truncated";
+      reader->offset += index;
+      return NULL;
+    }
+    if (!PL_get_integer(reader->byte, &value) || value < 0 || value > UINT8_MAX)
+    { reader->error = "not_a_byte";
+      reader->offset += index;
+      return NULL;
+    }
+    reader->bytes[index] = value;
+  }
+  reader->offset += count;
+  return reader->bytes;
+}
+
+/*
+ * Nested arrays and maps push frames onto an explicit container stack
+ * rather than recursing on the C stack. Nesting depth therefore costs
+ * heap, not machine stack, and only the max_depth budget bounds it.
+ * The first few frames live inside the stack itself; deeper messages
+ * move them to the heap, doubling as necessary.
+ *
+ * Each frame owns four term references: the list tail still to visit,
+ * the current element or pair, the key or value slot of the current
+ * pair, and the container itself. Frames at the same depth reuse the
+ * same references, so the number of references grows with the depth,
+ * never with the count of containers.
+ *
+ * The encoder also notes where each container starts, its ordinal and
+ * how many shared objects preceded it, for sharing.
+ */
+struct frame
+{ term_t tail;
+  term_t head;
+  term_t slot;
+  term_t term;
+  size_t length;
+  int map;
+  int value;
+  size_t start;
+  uint64_t ordinal;
+  size_t entries;
+};
+
+struct stack
+{ struct frame *frames;
+  size_t depth;
+  size_t capacity;
+  size_t refs;
+  struct frame buffer[32];
+};
+
+static void
+init_stack(struct stack *stack)
+{ stack->frames = stack->buffer;
+  stack->depth = 0;
+  stack->capacity = sizeof(stack->buffer) / sizeof(stack->buffer[0]);
+  stack->refs = 0;
+}
+
+static void
+release_stack(struct stack *stack)
+{ if (stack->frames != stack->buffer) free(stack->frames);
+}
+
+static int
+grow_stack(struct stack *stack)
+{ size_t capacity = stack->capacity << 1;
+  struct frame *frames;
+  if (capacity > SIZE_MAX / sizeof(*frames)) return PL_resource_error("memory");
+  if (stack->frames == stack->buffer)
+  { if ((frames = malloc(capacity * sizeof(*frames))))
+      memcpy(frames, stack->buffer, sizeof(stack->buffer));
+  } else frames = realloc(stack->frames, capacity * sizeof(*frames));
+  if (frames == NULL) return PL_resource_error("memory");
+  PROBE2(alloc, "stack", capacity * sizeof(*frames));
+  COUNT_ALLOCATED(capacity * sizeof(*frames));
+  stack->frames = frames;
+  stack->capacity = capacity;
+  PL_succeed;
+}
+
+/*
+ * Pushes a frame for a map or array. Answers NULL if the push would
+ * exceed the depth budget.
+ */
+static struct frame *
+push_frame(struct stack *stack, size_t max_depth, int map)
+{ struct frame *frame;
+  if (stack->depth == max_depth)
+  { budget_error("max_depth", max_depth);
+    return NULL;
+  }
+  if (stack->depth == stack->capacity && !grow_stack(stack)) return NULL;
+  frame = stack->frames + stack->depth;
+  if (stack->depth == stack->refs)
+  { term_t refs;
+    if (!(refs = PL_new_term_refs(4))) return NULL;
+    frame->tail = refs;
+    frame->head = refs + 1;
+    frame->slot = refs + 2;
+    frame->term = refs + 3;
+    stack->refs++;
+  }
+  stack->depth++;
+  frame->length = 0;
+  frame->map = map;
+  frame->value = FALSE;
+  return frame;
+}
+
+/*
+ * The decoder applies its budgets to each message separately. Start is
+ * the offset of the current message's first byte; elements counts the
+ * objects seen so far in the current message.
+ *
+ * When sharing, the decoder keeps a term reference for every str, bin,
+ * array, map and ext object of the current message, indexed by ordinal
+ * in order of appearance, so that back-references can unify with them.
+ * Each message reuses the references of the one before, so the count of
+ * references grows with the largest message rather than the batch.
+ */
+struct decoder
+{ struct reader reader;
+  struct stack stack;
+  const struct options *options;
+  size_t start;
+  size_t elements;
+  uint8_t format;
+  term_t arg;
+  term_t *shared;
+  size_t shared_count;
+  size_t shared_refs;
+  size_t shared_capacity;
+};
+
+static void
+init_decoder(struct decoder *decoder, const struct options *options, term_t Bytes0)
+{ init_reader(&decoder->reader, Bytes0);
+  init_stack(&decoder->stack);
+  decoder->options = options;
+  decoder->start = 0;
+  decoder->elements = 0;
+  decoder->arg = PL_new_term_ref();
+  decoder->shared = NULL;
+  decoder->shared_count = 0;
+  decoder->shared_refs = 0;
+  decoder->shared_capacity = 0;
+}
+
+static void
+release_decoder(struct decoder *decoder)
+{ free(decoder->shared);
+  release_stack(&decoder->stack);
+  release_reader(&decoder->reader);
+}
+
+/*
+ * Fails for malformed input unless strict, in which case raises a
+ * syntax error at the first malformed byte.
+ */
+static int
+decode_error(struct decoder *decoder, const char *reason, size_t offset)
+{ return decoder->options->strict ? syntax_error(reason, offset) : FALSE;
+}
+
+static const uint8_t *
+decode_bytes(struct decoder *decoder, size_t count)
+{ size_t max_total_bytes = decoder->options->max_total_bytes;
+  const uint8_t *bytes;
+  if (count > max_total_bytes - (decoder->reader.offset - decoder->start))
+  { budget_error("max_total_bytes", max_total_bytes);
+    return NULL;
+  }
+  if (!(bytes = read_bytes(&decoder->reader, count)) && decoder->reader.error)
+    decode_error(decoder, decoder->reader.error, decoder->reader.offset);
+  return bytes;
+}
+
+/*
+ * Decodes an unsigned big-endian integer of width bytes.
+ */
+static int
+decode_uint(struct decoder *decoder, size_t width, uint64_t *value)
+{ const uint8_t *bytes;
+  if (!(bytes = decode_bytes(decoder, width))) PL_fail;
+  for (*value = 0; width--; *value = *value << 8 | *bytes++);
+  PL_succeed;
+}
+
+/*
+ * Adds count to the running total of elements, raising a budget error
+ * instead if the total would exceed max_elements.
+ */
+static int
+count_elements(size_t max_elements, size_t *elements, size_t count)
+{ if (count > max_elements - *elements)
+    return budget_error("max_elements", max_elements);
+  *elements += count;
+  PL_succeed;
+}
+
+static int
+decode_elements(struct decoder *decoder, size_t count)
+{ return count_elements(decoder->options->max_elements, &decoder->elements, count);
+}
+
+/*
+ * Checks the budget for a str, bin or ext payload and reads the
+ * payload's length-prefixed bytes.
+ */
+static const uint8_t *
+decode_payload(struct decoder *decoder, size_t length, size_t extra)
+{ size_t max_str_bytes = decoder->options->max_str_bytes;
+  if (length > max_str_bytes)
+  { budget_error("max_str_bytes", max_str_bytes);
+    return NULL;
+  }
+  COUNT_BYTES(DECODING, decoder->format, length);
+  return decode_bytes(decoder, length + extra);
+}
+
+/*
+ * Validates UTF-8 byte sequences, rejecting stray continuation bytes,
+ * truncated sequences, over-long encodings, surrogates and code points
+ * beyond U+10FFFF. Answers the number of valid bytes before the first
+ * invalid sequence, or the length when all the bytes are valid.
+ */
+static size_t
+valid_utf8(const uint8_t *bytes, size_t length)
+{ const uint8_t *start = bytes, *end = bytes + length;
+  while (bytes < end)
+  { const uint8_t *sequence = bytes;
+    uint32_t code = *bytes++;
+    size_t more;
+    uint32_t min;
+    if (code < 0x80) continue;
+    if ((code & 0xe0) == 0xc0) more = 1, min = 0x80, code &= 0x1f;
+    else if ((code & 0xf0) == 0xe0) more = 2, min = 0x800, code &= 0x0f;
+    else if ((code & 0xf8) == 0xf0) more = 3, min = 0x10000, code &= 0x07;
+    else return sequence - start;
+    if ((size_t)(end - bytes) < more) return sequence - start;
+    while (more--)
+    { if ((*bytes & 0xc0) != 0x80) return sequence - start;
+      code = code << 6 | (*bytes++ & 0x3f);
+    }
+    if (code < min || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff))
+      return sequence - start;
+  }
+  return length;
+}
+
+/*
+ * Records Term as the next shared object of the message, if sharing.
+ */
+static int
+decode_shared(struct decoder *decoder, term_t Term)
+{ if (!decoder->options->share) PL_succeed;
+  if (decoder->shared_count == decoder->shared_capacity)
+  { size_t capacity = decoder->shared_capacity ? decoder->shared_capacity << 1 : 32;
+    term_t *shared;
+    if (capacity > SIZE_MAX / sizeof(*shared) ||
+        !(shared = realloc(decoder->shared, capacity * sizeof(*shared))))
+      return PL_resource_error("memory");
+    PROBE2(alloc, "shared", capacity * sizeof(*shared));
+    COUNT_ALLOCATED(capacity * sizeof(*shared));
+    decoder->shared = shared;
+    decoder->shared_capacity = capacity;
+  }
+  if (decoder->shared_count < decoder->shared_refs)
+  { if (!PL_put_term(decoder->shared[decoder->shared_count], Term)) PL_fail;
+  } else
+  { if (!(decoder->shared[decoder->shared_count] = PL_copy_term_ref(Term))) PL_fail;
+    decoder->shared_refs++;
+  }
+  decoder->shared_count++;
+  PL_succeed;
+}
+
+static int
+unify_int(struct decoder *decoder, term_t Term, int64_t value)
+{ return PL_unify_functor(Term, FUNCTOR_int1) &&
+         PL_get_arg(1, Term, decoder->arg) &&
+         PL_unify_int64(decoder->arg, value);
+}
+
+static int
+unify_uint(struct decoder *decoder, term_t Term, uint64_t value)
+{ return PL_unify_functor(Term, FUNCTOR_int1) &&
+         PL_get_arg(1, Term, decoder->arg) &&
+         PL_unify_uint64(decoder->arg, value);
+}
+
+static int
+decode_str(struct decoder *decoder, term_t Term, size_t length)
+{ const uint8_t *bytes;
+  size_t valid;
+  if (!(bytes = decode_payload(decoder, length, 0))) PL_fail;
+  if ((valid = valid_utf8(bytes, length)) != length)
+    return decode_error(decoder, "bad_utf8", decoder->reader.offset - length + valid);
+  return decode_shared(decoder, Term) &&
+         PL_unify_functor(Term, FUNCTOR_str1) &&
+         PL_get_arg(1, Term, decoder->arg) &&
+         PL_unify_chars(decoder->arg, PL_STRING|REP_UTF8, length, (const char *)bytes);
+}
+
+static int
+decode_bin(struct decoder *decoder, term_t Term, size_t length)
+{ const uint8_t *bytes;
+  if (!(bytes = decode_payload(decoder, length, 0))) PL_fail;
+  return decode_shared(decoder, Term) &&
+         PL_unify_functor(Term, FUNCTOR_bin1) &&
+         PL_get_arg(1, Term, decoder->arg) &&
+         PL_unify_chars(decoder->arg, PL_CODE_LIST, length, (const char *)bytes);
+}
+
+/*
+ * Decodes the payload of a timestamp ext, type -1, in any of its three
+ * layouts: 32-bit unsigned seconds; 30-bit nanoseconds and 34-bit
+ * unsigned seconds packed in 64 bits; or 32-bit nanoseconds followed by
+ * 64-bit signed seconds. Unifies Term with timestamp(Sec, NSec) when
+ * decoding with the timestamp(sec_nsec) option, else timestamp(Epoch)
+ * where Epoch is an integer for the 32-bit layout and a float for the
+ * others, the same as msgpack:type_ext_hook/3.
+ */
+static int
+decode_timestamp(struct decoder *decoder, term_t Term, const uint8_t *bytes, size_t length)
+{ uint32_t value32;
+  uint64_t value64;
+  int64_t sec;
+  uint32_t nsec;
+  switch (length)
+  { case 4:
+      memcpy(&value32, bytes, 4);
+      sec = be32(value32);
+      nsec = 0;
+      break;
+    case 8:
+      memcpy(&value64, bytes, 8);
+      value64 = be64(value64);
+      sec = value64 & ((UINT64_C(1) << 34) - 1);
+      nsec = value64 >> 34;
+      break;
+    case 12:
+      memcpy(&value32, bytes, 4);
+      memcpy(&value64, bytes + 4, 8);
+      nsec = be32(value32);
+      sec = (int64_t)be64(value64);
+      break;
+    default:
+      return decode_error(decoder, "bad_timestamp", decoder->reader.offset - length);
+  }
+  if (nsec >= 1000000000)
+    return decode_error(decoder, "bad_timestamp", decoder->reader.offset - length);
+  if (decoder->options->sec_nsec)
+    return PL_unify_functor(Term, FUNCTOR_timestamp2) &&
+           PL_get_arg(1, Term, decoder->arg) && PL_unify_int64(decoder->arg, sec) &&
+           PL_get_arg(2, Term, decoder->arg) && PL_unify_int64(decoder->arg, nsec);
+  return PL_unify_functor(Term, FUNCTOR_timestamp1) &&
+         PL_get_arg(1, Term, decoder->arg) &&
+         (length == 4 ? PL_unify_int64(decoder->arg, sec)
+                      : PL_unify_float(decoder->arg, sec + nsec / 1e9));
+}
+
+/*
+ * Unifies Term with an earlier object of the message given the
+ * big-endian ordinal of a back-reference. A reference to a container
+ * still open makes a cyclic term.
+ */
+static int
+decode_reference(struct decoder *decoder, term_t Term, const uint8_t *bytes, size_t length)
+{ uint64_t ordinal = 0;
+  size_t width;
+  for (width = 0; width < length; width++) ordinal = ordinal << 8 | bytes[width];
+  if (ordinal >= decoder->shared_count)
+    return decode_error(decoder, "bad_reference", decoder->reader.offset - length);
+  return PL_unify(Term, decoder->shared[ordinal]);
+}
+
+/*
+ * Decodes an ext by its registered codec, if any, else natively for
+ * timestamps. Otherwise passes the extension type and bytes to
+ * msgpack:type_ext_hook/3, by way of msgpackc:ext_dispatch/3, and
+ * unifies its third argument with Term. Fails if no hook accepts the
+ * type, the same as msgpack_ext//1. A registered codec that rejects its
+ * payload makes the ext malformed.
+ *
+ * When sharing, a fixext of the sharing type is a back-reference.
+ */
+static int
+decode_ext(struct decoder *decoder, term_t Term, size_t length)
+{ const struct ext *ext;
+  const uint8_t *bytes;
+  fid_t fid;
+  term_t Args;
+  int rc;
+  if (!(bytes = decode_payload(decoder, length, 1))) PL_fail;
+  if (decoder->options->share && (int8_t)bytes[0] == decoder->options->share_type &&
+      (length == 1 || length == 2 || length == 4 || length == 8))
+    return decode_reference(decoder, Term, bytes + 1, length);
+  if (!decode_shared(decoder, Term)) PL_fail;
+  ext = get_ext(bytes[0]);
+  if (!ext && (int8_t)bytes[0] == -1) return decode_timestamp(decoder, Term, bytes + 1, length);
+  if (!(fid = PL_open_foreign_frame())) PL_fail;
+  if (ext && ext->codec.decode)
+  { term_t Ext = PL_new_term_ref();
+    int malformed;
+    rc = ext->decode_bounded ? ext->decode_bounded(decoder, Ext, bytes + 1, length)
+                             : ext->codec.decode(Ext, bytes + 1, length, ext->codec.closure);
+    malformed = !rc && !PL_exception(0);
+    rc = rc && PL_unify(Term, Ext);
+    PL_close_foreign_frame(fid);
+    return malformed ? decode_error(decoder, "bad_ext", decoder->reader.offset - length) : rc;
+  }
+  if (ext)
+  { Args = PL_new_term_refs(2);
+    rc = PL_put_term(Args + 0, Term) &&
+         PL_unify_chars(Args + 1, PL_CODE_LIST, length, (const char *)bytes + 1) &&
+         PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, ext->predicate, Args);
+    PL_close_foreign_frame(fid);
+    return rc;
+  }
+  Args = PL_new_term_refs(3);
+  rc = PL_put_integer(Args + 0, (int8_t)bytes[0]) &&
+       PL_unify_chars(Args + 1, PL_CODE_LIST, length, (const char *)bytes + 1) &&
+       PL_put_term(Args + 2, Term) &&
+       PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, PREDICATE_ext_dispatch3, Args);
+  PL_close_foreign_frame(fid);
+  return rc;
+}
+
+/*
+ * Enforces the depth and element budgets for a container header before
+ * decoding any of its elements, then pushes a frame for the elements.
+ * Decoding continues with the first element, if any, in decode().
+ */
+static int
+decode_container(struct decoder *decoder, term_t Term, size_t length, int map)
+{ struct frame *frame;
+  if (map && length > SIZE_MAX >> 1)
+    return budget_error("max_elements", decoder->options->max_elements);
+  if (!decode_elements(decoder, map ? length << 1 : length) ||
+      !(frame = push_frame(&decoder->stack, decoder->options->max_depth, map))) PL_fail;
+  frame->length = length;
+  PROBE5(container_open, DECODING, decoder->reader.offset, decoder->format, length,
+         decoder->stack.depth);
+  return decode_shared(decoder, Term) &&
+         PL_unify_functor(Term, map ? FUNCTOR_map1 : FUNCTOR_array1) &&
+         PL_get_arg(1, Term, frame->tail);
+}
+
+/*
+ * Decodes one object by its lead byte. The fixed formats carry their
+ * value or length in the lead byte itself. The others encode the width
+ * of their value or length in the least-significant bits of the lead
+ * byte, hence the shifts by the offset from the first format in each
+ * family.
+ */
+static int
+decode_object(struct decoder *decoder, term_t Term)
+{ const uint8_t *bytes;
+  uint8_t format;
+  uint64_t value;
+  if (!(bytes = decode_bytes(decoder, 1))) PL_fail;
+  decoder->format = format = *bytes;
+  COUNT_OBJECTS(DECODING, format);
+  if (format <= 0x7f) return unify_int(decoder, Term, format);
+  if (format <= 0x8f) return decode_container(decoder, Term, format & 0x0f, TRUE);
+  if (format <= 0x9f) return decode_container(decoder, Term, format & 0x0f, FALSE);
+  if (format <= 0xbf) return decode_str(decoder, Term, format & 0x1f);
+  if (format >= 0xe0) return unify_int(decoder, Term, (int8_t)format);
+  switch (format)
+  { case 0xc0:
+      return PL_unify_atom(Term, ATOM_nil);
+    case 0xc2:
+      return PL_unify_term(Term, PL_FUNCTOR, FUNCTOR_bool1, PL_ATOM, ATOM_false);
+    case 0xc3:
+      return PL_unify_term(Term, PL_FUNCTOR, FUNCTOR_bool1, PL_ATOM, ATOM_true);
+    case 0xc4:
+    case 0xc5:
+    case 0xc6:
+      return decode_uint(decoder, 1 << (format - 0xc4), &value) &&
+             decode_bin(decoder, Term, value);
+    case 0xc7:
+    case 0xc8:
+    case 0xc9:
+      return decode_uint(decoder, 1 << (format - 0xc7), &value) &&
+             decode_ext(decoder, Term, value);
+    case 0xca:
+      return decode_uint(decoder, 4, &value) &&
+             PL_unify_term(Term, PL_FUNCTOR, FUNCTOR_float1,
+                           PL_FLOAT, (double)reinterpret_to_float32(value));
+    case 0xcb:
+      return decode_uint(decoder, 8, &value) &&
+             PL_unify_term(Term, PL_FUNCTOR, FUNCTOR_float1,
+                           PL_FLOAT, reinterpret_to_float64(value));
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+      return decode_uint(decoder, 1 << (format - 0xcc), &value) &&
+             unify_uint(decoder, Term, value);
+    case 0xd0:
+      return decode_uint(decoder, 1, &value) && unify_int(decoder, Term, (int8_t)value);
+    case 0xd1:
+      return decode_uint(decoder, 2, &value) && unify_int(decoder, Term, (int16_t)value);
+    case 0xd2:
+      return decode_uint(decoder, 4, &value) && unify_int(decoder, Term, (int32_t)value);
+    case 0xd3:
+      return decode_uint(decoder, 8, &value) && unify_int(decoder, Term, (int64_t)value);
+    case 0xd4:
+    case 0xd5:
+    case 0xd6:
+    case 0xd7:
+    case 0xd8:
+      return decode_ext(decoder, Term, 1 << (format - 0xd4));
+    case 0xd9:
+    case 0xda:
+    case 0xdb:
+      return decode_uint(decoder, 1 << (format - 0xd9), &value) &&
+             decode_str(decoder, Term, value);
+    case 0xdc:
+    case 0xdd:
+      return decode_uint(decoder, 2 << (format - 0xdc), &value) &&
+             decode_container(decoder, Term, value, FALSE);
+    case 0xde:
+    case 0xdf:
+      return decode_uint(decoder, 2 << (format - 0xde), &value) &&
+             decode_container(decoder, Term, value, TRUE);
+  }
+  return decode_error(decoder, "invalid_lead_byte", decoder->reader.offset - 1);
+}
+
+/*
+ * Decodes objects iteratively. After each object, finds the next slot
+ * to fill: the value of the current map pair, else the next element or
+ * pair of the innermost open container. Closes the list of any
+ * container without remaining elements and pops its frame. Decoding
+ * ends when the stack empties.
+ */
+static int
+decode(struct decoder *decoder, term_t Term)
+{ struct stack *stack = &decoder->stack;
+  term_t Object = Term;
+  for (;;)
+  { if (!decode_object(decoder, Object)) PL_fail;
+    for (;;)
+    { struct frame *frame;
+      if (stack->depth == 0) PL_succeed;
+      frame = stack->frames + stack->depth - 1;
+      if (frame->value)
+      { frame->value = FALSE;
+        if (!PL_get_arg(2, frame->head, frame->slot)) PL_fail;
+        Object = frame->slot;
+        break;
+      }
+      if (frame->length == 0)
+      { if (!PL_unify_nil(frame->tail)) PL_fail;
+        PROBE3(container_close, DECODING, decoder->reader.offset, stack->depth);
+        stack->depth--;
+        continue;
+      }
+      frame->length--;
+      if (!PL_unify_list(frame->tail, frame->head, frame->tail)) PL_fail;
+      if (frame->map)
+      { if (!PL_unify_functor(frame->head, FUNCTOR_minus2) ||
+            !PL_get_arg(1, frame->head, frame->slot)) PL_fail;
+        frame->value = TRUE;
+        Object = frame->slot;
+      } else Object = frame->head;
+      break;
+    }
+  }
+}
+
+static int
+decode_message(struct decoder *decoder, term_t Term)
+{ uint64_t started = START_LATENCY();
+  decoder->start = decoder->reader.offset;
+  decoder->elements = 0;
+  decoder->shared_count = 0;
+  PROBE2(message_start, DECODING, decoder->start);
+  if (!decode_elements(decoder, 1) || !decode(decoder, Term)) PL_fail;
+  PROBE3(message_end, DECODING, decoder->start, decoder->reader.offset - decoder->start);
+  COUNT_LATENCY(DECODING, started, decoder->reader.offset - decoder->start);
+  PL_succeed;
+}
+
+/*
+ * msgpack_decode(?Term, +Options, ?Bytes0, ?Bytes)
+ *
+ * Decodes one msgpack//1 Term from the head of the Bytes0 list leaving
+ * the unread tail in Bytes. Throws a budget error if the message
+ * exceeds any of the decoding budgets in Options, or a syntax error for
+ * malformed bytes when Options include strict(true).
+ */
+foreign_t
+msgpack_decode_4(term_t Term, term_t Options, term_t Bytes0, term_t Bytes)
+{ struct options parsed;
+  const struct options *options;
+  struct decoder decoder;
+  int rc;
+  if (!get_options(Options, &parsed, &options)) PL_fail;
+  init_decoder(&decoder, options, Bytes0);
+  rc = decode_message(&decoder, Term) && PL_unify(Bytes, decoder.reader.tail);
+  release_decoder(&decoder);
+  return rc;
+}
+
+/*
+ * msgpack_decode_all(+Bytes, -Terms, +Options)
+ *
+ * Decodes back-to-back messages until the bytes run out, all in one
+ * foreign call. Budgets apply to each message individually.
+ */
+foreign_t
+msgpack_decode_all_3(term_t Bytes, term_t Terms, term_t Options)
+{ struct options parsed;
+  const struct options *options;
+  struct decoder decoder;
+  term_t Tail = PL_copy_term_ref(Terms);
+  term_t Term = PL_new_term_ref();
+  int rc = TRUE;
+  if (!get_options(Options, &parsed, &options)) PL_fail;
+  init_decoder(&decoder, options, Bytes);
+  while (rc && !PL_get_nil(decoder.reader.tail))
+    rc = PL_unify_list(Tail, Term, Tail) && decode_message(&decoder, Term);
+  rc = rc && PL_unify_nil(Tail);
+  release_decoder(&decoder);
+  return rc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+The C encoder writes one msgpack//1 term using the same width selection
+as the grammar: the shortest format that fits, unsigned formats for
+non-negative integers, signed formats only for negatives, and 32-bit
+floats only when the least-significant 32 bits of the 64-bit float are
+zero. Terms outside the standard formats go to msgpack:type_ext_hook/3,
+just as msgpack//1 falls back to msgpack_ext//1.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*
+ * Writes bytes to a buffer that grows as necessary. A sizing writer has
+ * no bytes. It only counts, so that the encoder can answer the exact
+ * size of a message without encoding it. A fixed writer never grows;
+ * it writes into memory that the caller supplies and overflows rather
+ * than allocating.
+ */
+/*
+ * Turns a failure to write into an exception when the writer ran out of
+ * memory and nothing else has raised one already. Otherwise fails
+ * quietly, for instance when a fixed writer overflows.
+ */
+static int
+writer_error(const struct msgpackc_writer *writer)
+{ if (writer->error == MSGPACKC_NO_MEMORY && !PL_exception(0)) return PL_resource_error("memory");
+  PL_fail;
+}
+
+/*
+ * Writes a list of byte codes. Fails if the list is not a proper list
+ * of bytes.
+ */
+static int
+write_list_bytes(struct msgpackc_writer *writer, term_t Bytes, size_t length)
+{ term_t Tail = PL_copy_term_ref(Bytes);
+  term_t Byte = PL_new_term_ref();
+  uint8_t *bytes = NULL;
+  size_t count;
+  if (writer->bytes == NULL)
+  { if (!msgpackc_write_size(writer, length)) PL_fail;
+  } else if (!(bytes = msgpackc_write_bytes(writer, length))) PL_fail;
+  for (count = 0; count < length; count++)
+  { int value;
+    if (!PL_get_list(Tail, Byte, Tail) ||
+        !PL_get_integer(Byte, &value) ||
+        value < 0 || value > UINT8_MAX) PL_fail;
+    if (bytes) *bytes++ = value;
+  }
+  if (bytes) COUNT_BYTES(ENCODING, writer->format, length);
+  return PL_get_nil(Tail);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Sharing replaces repeated objects within one message by back-references.
+Every str, bin, array, map and ext object takes the next ordinal of the
+message in order of appearance, the same order in which the decoder
+meets them; nil, bool, int and float objects take none, nor do the
+references themselves. A reference is a fixext of the sharing type
+whose 1, 2, 4 or 8-byte big-endian payload is the ordinal of an
+earlier object.
+
+The encoder spots repeats by their encoded bytes. Once an object
+completes, the encoder hashes its bytes and looks for an earlier object
+with the same bytes; if found, it rewinds the writer and writes a
+reference instead. Objects of three bytes or fewer never pay back a
+reference and stay unshared. A container found again amongst its own
+ancestors, by identity, becomes a reference to the open ancestor; this
+preserves cycles that would otherwise exhaust max_depth. Only cyclic
+terms need the search, so the encoder checks each message for cycles
+up front when sharing, and skips it for acyclic ones.
+
+Sharing costs time in proportion to depth. Every container hashes its
+bytes on completion, nested ones included, so each byte hashes once
+for every container that encloses it; and, for cyclic terms, each
+container scans its open ancestors. Deep messages therefore cost time
+quadratic in their depth. The max_depth budget bounds both.
+
+The table lists shared objects in order of completion, chained into
+power-of-two buckets with the newest first, so that rewinding after a
+repeated container pops its nested entries off the heads of their
+chains.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+struct shared
+{ uint64_t hash;
+  size_t offset;
+  size_t length;
+  uint64_t ordinal;
+  size_t next;
+};
+
+struct share
+{ struct shared *entries;
+  size_t count;
+  size_t capacity;
+  size_t *buckets;
+  size_t mask;
+  uint64_t ordinal;
+};
+
+static void
+init_share(struct share *share)
+{ share->entries = NULL;
+  share->count = 0;
+  share->capacity = 0;
+  share->buckets = NULL;
+  share->mask = 0;
+  share->ordinal = 0;
+}
+
+static void
+release_share(struct share *share)
+{ free(share->entries);
+  free(share->buckets);
+}
+
+static void
+reset_share(struct share *share)
+{ if (share->buckets) memset(share->buckets, 0, (share->mask + 1) * sizeof(*share->buckets));
+  share->count = 0;
+  share->ordinal = 0;
+}
+
+/*
+ * FNV-1a, 64 bits.
+ */
+static uint64_t
+share_hash(const uint8_t *bytes, size_t length)
+{ uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  while (length--) hash = (hash ^ *bytes++) * UINT64_C(0x100000001b3);
+  return hash;
+}
+
+/*
+ * Buckets hold entry indices plus one, zero for none.
+ */
+static const struct shared *
+find_shared(const struct share *share, const uint8_t *bytes, uint64_t hash,
+            size_t offset, size_t length)
+{ size_t index;
+  if (share->buckets == NULL) return NULL;
+  for (index = share->buckets[hash & share->mask]; index; index = share->entries[index - 1].next)
+  { const struct shared *entry = share->entries + index - 1;
+    if (entry->hash == hash && entry->length == length &&
+        memcmp(bytes + entry->offset, bytes + offset, length) == 0) return entry;
+  }
+  return NULL;
+}
+
+static int
+grow_share(struct share *share)
+{ size_t capacity = share->capacity ? share->capacity << 1 : 64;
+  struct shared *entries;
+  size_t *buckets, index;
+  if (capacity > SIZE_MAX / sizeof(*entries)) return PL_resource_error("memory");
+  if (!(entries = realloc(share->entries, capacity * sizeof(*entries))))
+    return PL_resource_error("memory");
+  share->entries = entries;
+  share->capacity = capacity;
+  if (!(buckets = calloc(capacity, sizeof(*buckets)))) return PL_resource_error("memory");
+  PROBE2(alloc, "share", capacity * (sizeof(*entries) + sizeof(*buckets)));
+  COUNT_ALLOCATED(capacity * (sizeof(*entries) + sizeof(*buckets)));
+  free(share->buckets);
+  share->buckets = buckets;
+  share->mask = capacity - 1;
+  for (index = 0; index < share->count; index++)
+  { struct shared *entry = entries + index;
+    entry->next = buckets[entry->hash & share->mask];
+    buckets[entry->hash & share->mask] = index + 1;
+  }
+  PL_succeed;
+}
+
+static int
+add_shared(struct share *share, uint64_t hash, size_t offset, size_t length, uint64_t ordinal)
+{ struct shared *entry;
+  if (share->count == share->capacity && !grow_share(share)) PL_fail;
+  entry = share->entries + share->count++;
+  entry->hash = hash;
+  entry->offset = offset;
+  entry->length = length;
+  entry->ordinal = ordinal;
+  entry->next = share->buckets[hash & share->mask];
+  share->buckets[hash & share->mask] = share->count;
+  PL_succeed;
+}
+
+/*
+ * Pops entries back to count. Each popped entry heads its chain,
+ * having been added after all those that remain.
+ */
+static void
+pop_shared(struct share *share, size_t count)
+{ while (share->count > count)
+  { const struct shared *entry = share->entries + --share->count;
+    share->buckets[entry->hash & share->mask] = entry->next;
+  }
+}
+
+/*
+ * Writes a back-reference in the fewest bytes that hold its ordinal.
+ */
+static int
+write_reference(struct msgpackc_writer *writer, int8_t type, uint64_t ordinal)
+{ uint8_t bytes[8];
+  size_t width = ordinal >> 8 == 0 ? 1 : ordinal >> 16 == 0 ? 2 : ordinal >> 32 == 0 ? 4 : 8;
+  size_t index;
+  for (index = width; index--; ordinal >>= 8) bytes[index] = ordinal;
+  return msgpackc_write_ext(writer, type, bytes, width);
+}
+
+/*
+ * A cyclic term has no end. Without sharing, encoding one would nest
+ * until it met max_depth, or ran out of memory without a budget. The
+ * encoder checks for cycles once a message nests CYCLE_DEPTH deep, so
+ * that shallower messages never pay for the check. Sharing checks up
+ * front instead; see above.
+ */
+#define CYCLE_DEPTH 1024
+
+struct encoder
+{ struct msgpackc_writer writer;
+  struct stack stack;
+  const struct options *options;
+  term_t arg;
+  term_t root;
+  int checked;
+  int cyclic;
+  struct share share;
+};
+
+/*
+ * Initialises all but the writer.
+ */
+static void
+init_encoder(struct encoder *encoder, const struct options *options)
+{ init_stack(&encoder->stack);
+  encoder->options = options;
+  encoder->arg = PL_new_term_ref();
+  encoder->root = PL_new_term_ref();
+  init_share(&encoder->share);
+}
+
+static void
+release_encoder(struct encoder *encoder)
+{ release_share(&encoder->share);
+  release_stack(&encoder->stack);
+  msgpackc_writer_release(&encoder->writer);
+}
+
+/*
+ * Shares the object just written from offset, taking the given ordinal
+ * where entries counts the shared objects that preceded it. Either
+ * replaces the object by a reference to an earlier one with the same
+ * bytes, giving back the ordinals of it and its nested objects, or else
+ * adds the object to the table.
+ */
+static int
+share_object(struct encoder *encoder, size_t offset, uint64_t ordinal, size_t entries)
+{ struct msgpackc_writer *writer = &encoder->writer;
+  struct share *share = &encoder->share;
+  size_t length = writer->size - offset;
+  const struct shared *entry;
+  uint64_t hash;
+  if (length <= 3) PL_succeed;
+  hash = share_hash(writer->bytes + offset, length);
+  if ((entry = find_shared(share, writer->bytes, hash, offset, length)))
+  { uint64_t earlier = entry->ordinal;
+    pop_shared(share, entries);
+    share->ordinal = ordinal;
+    writer->size = offset;
+    return write_reference(writer, encoder->options->share_type, earlier);
+  }
+  return add_shared(share, hash, offset, length, ordinal);
+}
+
+/*
+ * Shares a str, bin or ext object written from offset.
+ */
+static int
+share_leaf(struct encoder *encoder, size_t offset)
+{ if (!encoder->options->share) PL_succeed;
+  return share_object(encoder, offset, encoder->share.ordinal++, encoder->share.count);
+}
+
+static int
+encode_int(struct encoder *encoder, term_t Int)
+{ int64_t value;
+  uint64_t unsigned_value;
+  if (PL_get_int64(Int, &value)) return msgpackc_write_int(&encoder->writer, value);
+  return PL_get_uint64(Int, &unsigned_value) &&
+         msgpackc_write_uint(&encoder->writer, unsigned_value);
+}
+
+static int
+encode_float(struct encoder *encoder, term_t Float)
+{ double value;
+  return PL_get_float(Float, &value) && msgpackc_write_float(&encoder->writer, value);
+}
+
+static int
+encode_str(struct encoder *encoder, term_t Str)
+{ char *chars;
+  size_t length;
+  return PL_is_string(Str) &&
+         PL_get_nchars(Str, &length, &chars, CVT_STRING|REP_UTF8) &&
+         msgpackc_write_str(&encoder->writer, chars, length);
+}
+
+static int
+encode_bin(struct encoder *encoder, term_t Bin)
+{ size_t length;
+  return PL_skip_list(Bin, 0, &length) == PL_LIST &&
+         msgpackc_write_bin_header(&encoder->writer, length) &&
+         write_list_bytes(&encoder->writer, Bin, length);
+}
+
+/*
+ * Writes the header for an array or a map and pushes a frame for its
+ * elements or pairs. Encoding continues with the first of them, if
+ * any, in encode(). When sharing, a container that is its own ancestor
+ * becomes a reference instead; otherwise a cyclic term raises a type
+ * error.
+ */
+static int
+encode_container(struct encoder *encoder, term_t Term, term_t List, int map)
+{ struct msgpackc_writer *writer = &encoder->writer;
+  struct stack *stack = &encoder->stack;
+  size_t start = writer->size;
+  struct frame *frame;
+  size_t length;
+  if (!encoder->checked && stack->depth >= CYCLE_DEPTH)
+  { encoder->checked = TRUE;
+    if ((encoder->cyclic = !PL_is_acyclic(encoder->root)))
+      return PL_type_error("acyclic_term", encoder->root);
+  }
+  if (encoder->cyclic)
+  { for (frame = stack->frames; frame < stack->frames + stack->depth; frame++)
+      if (PL_same_compound(frame->term, Term))
+        return write_reference(writer, encoder->options->share_type, frame->ordinal);
+  }
+  if (PL_skip_list(List, 0, &length) != PL_LIST ||
+      !(map ? msgpackc_write_map(writer, length) : msgpackc_write_array(writer, length)) ||
+      !(frame = push_frame(stack, encoder->options->max_depth, map))) PL_fail;
+  PROBE5(container_open, ENCODING, writer->size, writer->format, length, stack->depth);
+  frame->start = start;
+  frame->ordinal = encoder->share.ordinal++;
+  frame->entries = encoder->share.count;
+  return PL_put_term(frame->term, Term) && PL_put_term(frame->tail, List);
+}
+
+/*
+ * Writes a timestamp ext in the smallest layout that holds it: 32 bits
+ * for whole non-negative seconds below 2^32, 64 bits for non-negative
+ * seconds below 2^34, else 96 bits.
+ */
+static int
+write_timestamp(struct msgpackc_writer *writer, int64_t sec, uint32_t nsec)
+{ uint8_t bytes[12];
+  uint32_t value32;
+  uint64_t value64;
+  if (sec >= 0 && sec >> 34 == 0)
+  { if (nsec == 0 && sec >> 32 == 0)
+    { value32 = be32(sec);
+      return msgpackc_write_ext(writer, -1, &value32, 4);
+    }
+    value64 = be64((uint64_t)nsec << 34 | sec);
+    return msgpackc_write_ext(writer, -1, &value64, 8);
+  }
+  value32 = be32(nsec);
+  value64 = be64(sec);
+  memcpy(bytes, &value32, 4);
+  memcpy(bytes + 4, &value64, 8);
+  return msgpackc_write_ext(writer, -1, bytes, 12);
+}
+
+/*
+ * Encodes timestamp(Sec, NSec) for integers Sec and NSec, the latter
+ * between 0 and 999999999, or timestamp(Epoch) for a non-negative
+ * integer or float Epoch, the same as msgpack//1. Splits a float into
+ * whole seconds, rounding down, and nanoseconds, rounding to nearest.
+ * Fails for anything else.
+ */
+static int
+encode_timestamp(struct encoder *encoder, term_t Term)
+{ int64_t sec, nsec;
+  double epoch, floor_epoch;
+  if (PL_is_functor(Term, FUNCTOR_timestamp2))
+    return PL_get_arg(1, Term, encoder->arg) && PL_get_int64(encoder->arg, &sec) &&
+           PL_get_arg(2, Term, encoder->arg) && PL_get_int64(encoder->arg, &nsec) &&
+           nsec >= 0 && nsec < 1000000000 &&
+           write_timestamp(&encoder->writer, sec, nsec);
+  if (!PL_is_functor(Term, FUNCTOR_timestamp1) || !PL_get_arg(1, Term, encoder->arg)) PL_fail;
+  if (PL_get_int64(encoder->arg, &sec)) return sec >= 0 && write_timestamp(&encoder->writer, sec, 0);
+  if (!PL_get_float(encoder->arg, &epoch) || !isfinite(epoch) || epoch < 0) PL_fail;
+  floor_epoch = floor(epoch);
+  if (floor_epoch >= 0x1p63) PL_fail;
+  sec = floor_epoch;
+  nsec = llround((epoch - floor_epoch) * 1e9);
+  if (nsec == 1000000000)
+  { sec++;
+    nsec = 0;
+  }
+  return write_timestamp(&encoder->writer, sec, nsec);
+}
+
+/*
+ * Encodes a ground Term by its registered ext codec, if any, else asks
+ * msgpack:type_ext_hook/3 for its type and bytes, then writes the
+ * shortest ext format for the bytes. A registered codec that fails
+ * falls back to the hook. Timestamps without a registered codec encode
+ * natively, falling back likewise.
+ */
+static int
+encode_ext(struct encoder *encoder, term_t Term)
+{ struct msgpackc_writer *writer = &encoder->writer;
+  fid_t fid;
+  term_t Args;
+  const struct ext *ext;
+  int8_t ext_type;
+  int type;
+  size_t length;
+  int rc;
+  ext = find_ext(Term, &ext_type);
+  if (ext && (ext->codec.encode || PL_is_ground(Term)))
+  { size_t size = writer->size;
+    if (ext->codec.encode)
+    { if (ext->codec.encode(Term, writer, ext->codec.closure)) PL_succeed;
+    } else
+    { if (!(fid = PL_open_foreign_frame())) PL_fail;
+      Args = PL_new_term_refs(2);
+      rc = PL_put_term(Args + 0, Term) &&
+           PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, ext->predicate, Args) &&
+           PL_skip_list(Args + 1, 0, &length) == PL_LIST &&
+           msgpackc_write_ext_header(writer, ext_type, length) &&
+           write_list_bytes(writer, Args + 1, length);
+      PL_discard_foreign_frame(fid);
+      if (rc) PL_succeed;
+    }
+    if (PL_exception(0) ||
+        writer->error == MSGPACKC_NO_MEMORY ||
+        writer->error == MSGPACKC_OVERFLOW) PL_fail;
+    writer->error = MSGPACKC_OK;
+    writer->size = size;
+  } else if (ext == NULL)
+  { size_t size = writer->size;
+    if (encode_timestamp(encoder, Term)) PL_succeed;
+    if (writer->error == MSGPACKC_NO_MEMORY || writer->error == MSGPACKC_OVERFLOW) PL_fail;
+    writer->size = size;
+  }
+  if (!PL_is_ground(Term)) PL_fail;
+  if (!(fid = PL_open_foreign_frame())) PL_fail;
+  Args = PL_new_term_refs(3);
+  rc = PL_put_term(Args + 2, Term) &&
+       PL_call_predicate(NULL, PL_Q_PASS_EXCEPTION, PREDICATE_ext_dispatch3, Args) &&
+       PL_get_integer(Args + 0, &type) && type >= INT8_MIN && type <= INT8_MAX &&
+       PL_skip_list(Args + 1, 0, &length) == PL_LIST;
+  rc = rc && msgpackc_write_ext_header(writer, type, length) &&
+       write_list_bytes(writer, Args + 1, length);
+  PL_discard_foreign_frame(fid);
+  return rc;
+}
+
+/*
+ * Encodes one object. Terms that fail to encode in their standard
+ * format fall back to the ext hook, after discarding any bytes that
+ * the failed attempt wrote, unless the attempt raised an exception.
+ */
+static int
+encode_object(struct encoder *encoder, term_t Term)
+{ size_t size = encoder->writer.size;
+  atom_t name;
+  functor_t functor;
+  if (PL_get_atom(Term, &name))
+  { if (name == ATOM_nil) return msgpackc_write_nil(&encoder->writer);
+  } else if (PL_get_functor(Term, &functor) && PL_get_arg(1, Term, encoder->arg))
+  { int rc = FALSE;
+    if (functor == FUNCTOR_bool1)
+    { if (PL_get_atom(encoder->arg, &name))
+      { if (name == ATOM_false) return msgpackc_write_bool(&encoder->writer, FALSE);
+        if (name == ATOM_true) return msgpackc_write_bool(&encoder->writer, TRUE);
+      }
+    } else if (functor == FUNCTOR_int1) rc = encode_int(encoder, encoder->arg);
+    else if (functor == FUNCTOR_float1) rc = encode_float(encoder, encoder->arg);
+    else if (functor == FUNCTOR_str1)
+      rc = encode_str(encoder, encoder->arg) && share_leaf(encoder, size);
+    else if (functor == FUNCTOR_bin1)
+      rc = encode_bin(encoder, encoder->arg) && share_leaf(encoder, size);
+    else if (functor == FUNCTOR_array1)
+      rc = encode_container(encoder, Term, encoder->arg, FALSE);
+    else if (functor == FUNCTOR_map1)
+      rc = encode_container(encoder, Term, encoder->arg, TRUE);
+    if (rc) PL_succeed;
+    if (PL_exception(0) ||
+        encoder->writer.error == MSGPACKC_NO_MEMORY ||
+        encoder->writer.error == MSGPACKC_OVERFLOW) PL_fail;
+    encoder->writer.error = MSGPACKC_OK;
+    encoder->writer.size = size;
+  }
+  return encode_ext(encoder, Term) && share_leaf(encoder, size);
+}
+
+/*
+ * Encodes objects iteratively, the mirror image of decode(). Fails for
+ * any map element that is not a Key-Value pair.
+ */
+static int
+encode(struct encoder *encoder, term_t Term)
+{ struct stack *stack = &encoder->stack;
+  term_t Object = Term;
+  reset_share(&encoder->share);
+  if (!PL_put_term(encoder->root, Term)) PL_fail;
+  encoder->checked = encoder->options->share;
+  encoder->cyclic = encoder->checked && !PL_is_acyclic(Term);
+  for (;;)
+  { if (!encode_object(encoder, Object)) PL_fail;
+    for (;;)
+    { struct frame *frame;
+      if (stack->depth == 0) PL_succeed;
+      frame = stack->frames + stack->depth - 1;
+      if (frame->value)
+      { frame->value = FALSE;
+        if (!PL_get_arg(2, frame->head, frame->slot)) PL_fail;
+        Object = frame->slot;
+        break;
+      }
+      if (!PL_get_list(frame->tail, frame->head, frame->tail))
+      { PROBE3(container_close, ENCODING, encoder->writer.size, stack->depth);
+        stack->depth--;
+        if (encoder->options->share &&
+            !share_object(encoder, frame->start, frame->ordinal, frame->entries)) PL_fail;
+        continue;
+      }
+      if (frame->map)
+      { if (!PL_is_functor(frame->head, FUNCTOR_minus2) ||
+            !PL_get_arg(1, frame->head, frame->slot)) PL_fail;
+        frame->value = TRUE;
+        Object = frame->slot;
+      } else Object = frame->head;
+      break;
+    }
+  }
+}
+
+/*
+ * Encodes one message, recording its latency unless only sizing.
+ */
+static int
+encode_message(struct encoder *encoder, term_t Term)
+{ uint64_t started = START_LATENCY();
+  size_t size = encoder->writer.size;
+  PROBE2(message_start, ENCODING, size);
+  if (!encode(encoder, Term)) return writer_error(&encoder->writer);
+  PROBE3(message_end, ENCODING, size, encoder->writer.size - size);
+  if (encoder->writer.bytes)
+    COUNT_LATENCY(ENCODING, started, encoder->writer.size - size);
+  PL_succeed;
+}
+
+/*
+ * msgpack_encode(+Term, +Options, ?Bytes0, ?Bytes)
+ *
+ * Encodes one msgpack//1 Term as bytes at the head of Bytes0 with Bytes
+ * as the tail. Of the decoding budgets, only max_depth applies. Raises
+ * a type error for a cyclic Term unless sharing.
+ */
+foreign_t
+msgpack_encode_4(term_t Term, term_t Options, term_t Bytes0, term_t Bytes)
+{ struct options parsed;
+  const struct options *options;
+  struct encoder encoder;
+  int rc;
+  if (!get_options(Options, &parsed, &options)) PL_fail;
+  msgpackc_writer_init(&encoder.writer);
+  init_encoder(&encoder, options);
+  rc = encode_message(&encoder, Term) &&
+       unify_list_bytes(Bytes0, Bytes, encoder.writer.size, encoder.writer.bytes);
+  release_encoder(&encoder);
+  return rc;
+}
+
+/*
+ * msgpack_encode_all(+Terms, -Bytes, +Options)
+ *
+ * Encodes a list of terms back to back into one writer, then unifies
+ * Bytes with one list of all their bytes.
+ */
+foreign_t
+msgpack_encode_all_3(term_t Terms, term_t Bytes, term_t Options)
+{ struct options parsed;
+  const struct options *options;
+  struct encoder encoder;
+  term_t Tail = PL_copy_term_ref(Terms);
+  term_t Term = PL_new_term_ref();
+  term_t Nil = PL_new_term_ref();
+  int rc = TRUE;
+  if (!get_options(Options, &parsed, &options)) PL_fail;
+  msgpackc_writer_init(&encoder.writer);
+  init_encoder(&encoder, options);
+  while (rc && PL_get_list(Tail, Term, Tail)) rc = encode_message(&encoder, Term);
+  rc = rc && PL_get_nil_ex(Tail) && PL_put_nil(Nil) &&
+       unify_list_bytes(Bytes, Nil, encoder.writer.size, encoder.writer.bytes);
+  release_encoder(&encoder);
+  return rc;
+}
+
+/*
+ * msgpack_size(+Term, -Size, +Options)
+ *
+ * Runs the encoder with a sizing writer. Size is exactly the number of
+ * bytes that msgpack_encode//2 would write for Term, computed without
+ * storing any of them. Sharing compares the bytes of objects, however,
+ * and so stores them after all.
+ */
+foreign_t
+msgpack_size_3(term_t Term, term_t Size, term_t Options)
+{ struct options parsed;
+  const struct options *options;
+  struct encoder encoder;
+  int rc;
+  if (!get_options(Options, &parsed, &options)) PL_fail;
+  if (options->share) msgpackc_writer_init(&encoder.writer);
+  else msgpackc_writer_init_sizing(&encoder.writer);
+  init_encoder(&encoder, options);
+  rc = (encode(&encoder, Term) || writer_error(&encoder.writer)) &&
+       PL_unify_uint64(Size, encoder.writer.size);
+  release_encoder(&encoder);
+  return rc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+A buffer blob wraps a fixed block of mutable bytes, allocated once when
+created and freed when the atom garbage collector reclaims the blob.
+Encoding into a buffer writes the bytes in place: no allocation, no
+list cells and hence no garbage, provided that Term uses only standard
+formats. Extension terms call the Prolog hook, which may allocate.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+struct buffer
+{ size_t size;
+  uint8_t bytes[];
+};
+
+static int
+release_buffer(atom_t Buffer)
+{ free(*(struct buffer **)PL_blob_data(Buffer, NULL, NULL));
+  PL_succeed;
+}
+
+static PL_blob_t buffer_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_NOCOPY|PL_BLOB_UNIQUE,
+  "msgpack_buffer",
+  release_buffer,
+};
+
+static int
+get_buffer(term_t Buffer, struct buffer **buffer)
+{ void *data;
+  PL_blob_t *type;
+  if (PL_get_blob(Buffer, &data, NULL, &type) && type == &buffer_blob)
+  { *buffer = *(struct buffer **)data;
+    PL_succeed;
+  }
+  return PL_type_error("msgpack_buffer", Buffer);
+}
+
+/*
+ * Gets an offset within a buffer, from zero up to and including its
+ * size.
+ */
+static int
+get_buffer_offset(term_t Offset, const struct buffer *buffer, size_t *offset)
+{ if (!PL_get_size_ex(Offset, offset)) PL_fail;
+  if (*offset > buffer->size) return PL_domain_error("msgpack_buffer_offset", Offset);
+  PL_succeed;
+}
+
+foreign_t
+msgpack_buffer_create_2(term_t Size, term_t Buffer)
+{ struct buffer *buffer;
+  size_t size;
+  if (!PL_get_size_ex(Size, &size)) PL_fail;
+  if (size > SIZE_MAX - sizeof(*buffer) ||
+      !(buffer = calloc(1, sizeof(*buffer) + size))) return PL_resource_error("memory");
+  PROBE2(alloc, "buffer", sizeof(*buffer) + size);
+  COUNT_ALLOCATED(sizeof(*buffer) + size);
+  buffer->size = size;
+  return PL_unify_blob(Buffer, &buffer, sizeof(buffer), &buffer_blob);
+}
+
+foreign_t
+msgpack_buffer_size_2(term_t Buffer, term_t Size)
+{ struct buffer *buffer = NULL;
+  return get_buffer(Buffer, &buffer) && PL_unify_uint64(Size, buffer->size);
+}
+
+foreign_t
+msgpack_buffer_bytes_4(term_t Buffer, term_t Offset, term_t Length, term_t Bytes)
+{ struct buffer *buffer = NULL;
+  size_t offset, length;
+  if (!get_buffer(Buffer, &buffer) ||
+      !get_buffer_offset(Offset, buffer, &offset) ||
+      !PL_get_size_ex(Length, &length)) PL_fail;
+  if (length > buffer->size - offset) return PL_domain_error("msgpack_buffer_length", Length);
+  return PL_unify_chars(Bytes, PL_CODE_LIST, length, (const char *)buffer->bytes + offset);
+}
+
+/*
+ * msgpack_encode_into(+Buffer, +Offset0, +Term, -Offset, +Options)
+ *
+ * Encodes Term into Buffer starting at Offset0 using a fixed writer.
+ * Fails if the encoded Term does not fit; bytes beyond Offset0 are then
+ * undefined.
+ */
+foreign_t
+msgpack_encode_into_5(term_t Buffer, term_t Offset0, term_t Term, term_t Offset, term_t Options)
+{ struct options parsed;
+  const struct options *options;
+  struct buffer *buffer = NULL;
+  struct encoder encoder;
+  size_t offset;
+  int rc;
+  if (!get_buffer(Buffer, &buffer) ||
+      !get_buffer_offset(Offset0, buffer, &offset) ||
+      !get_options(Options, &parsed, &options)) PL_fail;
+  msgpackc_writer_init_fixed(&encoder.writer, buffer->bytes + offset, buffer->size - offset);
+  init_encoder(&encoder, options);
+  rc = encode_message(&encoder, Term) && PL_unify_uint64(Offset, offset + encoder.writer.size);
+  release_encoder(&encoder);
+  return rc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+The `GMP=1` build option adds an ext codec for integers beyond 64 bits,
+which otherwise have no MessagePack format. It registers for functor
+int/1, so only integers that fail to encode as int formats reach it.
+The payload is one sign byte, 0 for positive and 1 for negative,
+followed by the magnitude in big-endian bytes as mpz_export() lays them
+out: no leading zero bytes. Decoding gives int(Integer) back.
+
+No ext type belongs to the codec by default, since applications may
+already use any of them. msgpack_register_bignum_ext/1 picks one at run
+time, or MSGPACKC_BIGNUM_TYPE when compiling registers one at load time.
+The Prolog flag `msgpackc_bignum_type` holds the type once registered.
+
+Every integer has exactly one encoding. Decoding rejects payloads with
+leading zero bytes, a negative zero, or a value that fits the int
+formats.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef MSGPACKC_GMP
+
+static int
+encode_bignum(term_t Term, struct msgpackc_writer *writer, void *closure)
+{ term_t Int = PL_new_term_ref();
+  uint8_t buffer[64], *bytes = buffer;
+  size_t length;
+  mpz_t value;
+  int rc;
+  if (!PL_get_arg(1, Term, Int) || !PL_is_integer(Int)) PL_fail;
+  mpz_init(value);
+  if (!PL_get_mpz(Int, value))
+  { mpz_clear(value);
+    PL_fail;
+  }
+  length = 1 + (mpz_sizeinbase(value, 2) + 7) / 8;
+  if (length > sizeof(buffer) && !(bytes = malloc(length)))
+  { mpz_clear(value);
+    return msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+  }
+  bytes[0] = mpz_sgn(value) < 0;
+  mpz_export(bytes + 1, &length, 1, 1, 1, 0, value);
+  rc = msgpackc_write_ext(writer, (int8_t)(intptr_t)closure, bytes, 1 + length);
+  if (bytes != buffer) free(bytes);
+  mpz_clear(value);
+  return rc;
+}
+
+static int
+decode_bignum(term_t Term, const uint8_t *bytes, size_t length, void *closure)
+{ term_t Int = PL_new_term_ref();
+  mpz_t value;
+  int rc;
+  (void)closure;
+  if (length < 2 || bytes[0] > 1 || bytes[1] == 0) PL_fail;
+  if (length < 1 + 8 || (length == 1 + 8 && (bytes[0] == 0 || bytes[1] < 0x80))) PL_fail;
+  if (length == 1 + 8 && bytes[1] == 0x80)
+  { size_t index;
+    for (index = 2; index < length && bytes[index] == 0; index++);
+    if (index == length) PL_fail;
+  }
+  mpz_init(value);
+  mpz_import(value, length - 1, 1, 1, 1, 0, bytes + 1);
+  if (bytes[0]) mpz_neg(value, value);
+  rc = PL_unify_functor(Term, FUNCTOR_int1) &&
+       PL_get_arg(1, Term, Int) &&
+       PL_unify_mpz(Int, value);
+  mpz_clear(value);
+  return rc;
+}
+
+static int
+register_bignum_ext(int8_t type)
+{ struct msgpackc_ext_codec codec = { FUNCTOR_int1, encode_bignum, decode_bignum, NULL };
+  codec.closure = (void *)(intptr_t)type;
+  if (!msgpackc_register_ext(type, &codec)) PL_fail;
+  PL_set_prolog_flag("msgpackc_bignum_type", PL_INTEGER, (intptr_t)type);
+  PL_succeed;
+}
+
+#endif
+
+/*
+ * register_bignum_ext(+Type)
+ *
+ * Registers the GMP bignum codec for Type. Raises an existence error
+ * for the build option when compiled without GMP.
+ */
+static foreign_t
+register_bignum_ext_1(term_t Type)
+{ int type;
+  if (!PL_get_integer_ex(Type, &type)) PL_fail;
+  if (type < INT8_MIN || type > INT8_MAX) return PL_domain_error("msgpack_ext_type", Type);
+#ifdef MSGPACKC_GMP
+  return register_bignum_ext(type);
+#else
+  { term_t Option = PL_new_term_ref();
+    return PL_put_atom_chars(Option, "gmp") && PL_existence_error("build_option", Option);
+  }
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+The Prolog term ext carries any acyclic term made of atoms, compounds,
+lists, variables, strings, and integers and floats that fit 64 bits.
+msgpack_register_term_ext/1 picks its type; term(Term) then encodes as
+that type and decodes back. The payload is MessagePack throughout:
+
+    array of 2K    Name1, Arity1, ..., NameK, ArityK
+    uint           number of distinct variables
+    node           Term
+
+where a node is an int, float or str for numbers and strings, else an
+array led by a uint: 0 for a list, followed by its elements and then its
+tail; 1 for a variable, followed by its number; 2 for []; or 3 + I for
+functor I of the table, followed by the arguments. Each functor's name
+and arity appears once however often it recurs. Peers that do not know
+the type skip the ext by its length.
+
+Encoding numbers the variables by binding each, on first sight, to a
+marker term carrying the number and a variable private to the encoder,
+and discards the bindings afterwards. Both directions iterate over the
+container stack; a frame's tail holds the compound or the remaining
+list, its length counts the arguments or elements left, and its map
+flag marks lists.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+enum term_node
+{ TERM_LIST,
+  TERM_VAR,
+  TERM_NIL,
+  TERM_FUNCTORS
+};
+
+struct term_functor
+{ functor_t functor;
+  size_t index;
+};
+
+struct term_encoder
+{ struct msgpackc_writer table;
+  struct msgpackc_writer body;
+  struct stack stack;
+  struct term_functor *functors;
+  size_t functor_slots;
+  size_t functor_count;
+  size_t var_count;
+  term_t key;
+  term_t arg;
+  term_t child;
+};
+
+static void
+init_term_encoder(struct term_encoder *encoder)
+{ msgpackc_writer_init(&encoder->table);
+  msgpackc_writer_init(&encoder->body);
+  init_stack(&encoder->stack);
+  encoder->functors = NULL;
+  encoder->functor_slots = 0;
+  encoder->functor_count = 0;
+  encoder->var_count = 0;
+  encoder->key = PL_new_term_ref();
+  encoder->arg = PL_new_term_ref();
+  encoder->child = PL_new_term_ref();
+}
+
+static void
+release_term_encoder(struct term_encoder *encoder)
+{ msgpackc_writer_release(&encoder->table);
+  msgpackc_writer_release(&encoder->body);
+  release_stack(&encoder->stack);
+  free(encoder->functors);
+}
+
+/*
+ * Finds the slot holding a functor, else the empty slot where it
+ * belongs. Open addressing with linear probing over a power-of-two
+ * number of slots, never full.
+ */
+static struct term_functor *
+functor_slot(struct term_functor *functors, size_t slots, functor_t functor)
+{ size_t n = (size_t)((uint64_t)functor * UINT64_C(0x9e3779b97f4a7c15) >> 32) & (slots - 1);
+  while (functors[n].functor && functors[n].functor != functor) n = (n + 1) & (slots - 1);
+  return functors + n;
+}
+
+/*
+ * Finds the table index of a functor, adding the functor to the table
+ * on first sight. The slots double whenever they become half full.
+ */
+static int
+term_functor_index(struct term_encoder *encoder, functor_t functor, size_t *index)
+{ struct term_functor *slot;
+  char *chars;
+  size_t length;
+  if (encoder->functor_slots &&
+      (slot = functor_slot(encoder->functors, encoder->functor_slots, functor))->functor)
+  { *index = slot->index;
+    PL_succeed;
+  }
+  if (encoder->functor_count << 1 >= encoder->functor_slots)
+  { size_t slots = encoder->functor_slots ? encoder->functor_slots << 1 : 64, n;
+    struct term_functor *functors = calloc(slots, sizeof(*functors));
+    if (functors == NULL) return PL_resource_error("memory");
+    PROBE2(alloc, "functors", slots * sizeof(*functors));
+    COUNT_ALLOCATED(slots * sizeof(*functors));
+    for (n = 0; n < encoder->functor_slots; n++)
+      if (encoder->functors[n].functor)
+        *functor_slot(functors, slots, encoder->functors[n].functor) = encoder->functors[n];
+    free(encoder->functors);
+    encoder->functors = functors;
+    encoder->functor_slots = slots;
+  }
+  if (!PL_put_atom(encoder->arg, PL_functor_name(functor)) ||
+      !PL_get_nchars(encoder->arg, &length, &chars, CVT_ATOM|REP_UTF8) ||
+      !msgpackc_write_str(&encoder->table, chars, length) ||
+      !msgpackc_write_uint(&encoder->table, PL_functor_arity(functor))) PL_fail;
+  slot = functor_slot(encoder->functors, encoder->functor_slots, functor);
+  slot->functor = functor;
+  *index = slot->index = encoder->functor_count++;
+  PL_succeed;
+}
+
+/*
+ * Pushes a frame for the arguments of a compound or the elements of a
+ * list, then continues in write_term() or read_term().
+ */
+static int
+push_term_frame(struct stack *stack, term_t Term, size_t length, int list)
+{ struct frame *frame = push_frame(stack, SIZE_MAX, list);
+  if (frame == NULL || !PL_put_term(frame->tail, Term)) PL_fail;
+  frame->length = length;
+  PL_succeed;
+}
+
+static int
+write_term_node(struct term_encoder *encoder, term_t Term)
+{ struct msgpackc_writer *body = &encoder->body;
+  int64_t value;
+  uint64_t unsigned_value;
+  double float_value;
+  char *chars;
+  atom_t name;
+  functor_t functor;
+  size_t length, index;
+  switch (PL_term_type(Term))
+  { case PL_VARIABLE:
+      if (PL_is_attvar(Term) ||
+          !PL_unify_functor(Term, FUNCTOR_msgpackc_var2) ||
+          !PL_get_arg(1, Term, encoder->arg) ||
+          !PL_unify_uint64(encoder->arg, encoder->var_count) ||
+          !PL_get_arg(2, Term, encoder->arg) ||
+          !PL_unify(encoder->arg, encoder->key)) PL_fail;
+      return msgpackc_write_array(body, 2) &&
+             msgpackc_write_uint(body, TERM_VAR) &&
+             msgpackc_write_uint(body, encoder->var_count++);
+    case PL_INTEGER:
+      if (PL_get_int64(Term, &value)) return msgpackc_write_int(body, value);
+      return PL_get_uint64(Term, &unsigned_value) && msgpackc_write_uint(body, unsigned_value);
+    case PL_FLOAT:
+      return PL_get_float(Term, &float_value) && msgpackc_write_float(body, float_value);
+    case PL_STRING:
+      return PL_get_nchars(Term, &length, &chars, CVT_STRING|REP_UTF8) &&
+             msgpackc_write_str(body, chars, length);
+    case PL_NIL:
+      return msgpackc_write_array(body, 1) && msgpackc_write_uint(body, TERM_NIL);
+    case PL_ATOM:
+      return PL_get_atom(Term, &name) &&
+             term_functor_index(encoder, PL_new_functor(name, 0), &index) &&
+             msgpackc_write_array(body, 1) &&
+             msgpackc_write_uint(body, TERM_FUNCTORS + index);
+    case PL_LIST_PAIR:
+      PL_skip_list(Term, 0, &length);
+      return msgpackc_write_array(body, 2 + length) &&
+             msgpackc_write_uint(body, TERM_LIST) &&
+             push_term_frame(&encoder->stack, Term, length, TRUE);
+    case PL_TERM:
+      if (!PL_get_functor(Term, &functor)) PL_fail;
+      if (functor == FUNCTOR_msgpackc_var2 &&
+          PL_get_arg(2, Term, encoder->arg) && PL_compare(encoder->arg, encoder->key) == 0)
+        return PL_get_arg(1, Term, encoder->arg) &&
+               PL_get_uint64(encoder->arg, &unsigned_value) &&
+               msgpackc_write_array(body, 2) &&
+               msgpackc_write_uint(body, TERM_VAR) &&
+               msgpackc_write_uint(body, unsigned_value);
+      length = PL_functor_arity(functor);
+      return term_functor_index(encoder, functor, &index) &&
+             msgpackc_write_array(body, 1 + length) &&
+             msgpackc_write_uint(body, TERM_FUNCTORS + index) &&
+             push_term_frame(&encoder->stack, Term, length, FALSE);
+    default:
+      PL_fail;
+  }
+}
+
+/*
+ * Writes the payload of the Prolog term ext for Term, preceded by an ext
+ * header of the given type if ext is true. Fails for cyclic terms and
+ * for terms with blobs, dicts, rationals, big integers or attributed
+ * variables. Leaves Term as it found it.
+ */
+static int
+write_term(struct msgpackc_writer *writer, term_t Term, int8_t type, int ext)
+{ struct term_encoder encoder;
+  struct msgpackc_writer sizing;
+  fid_t fid;
+  int rc;
+  if (!PL_is_acyclic(Term) || !(fid = PL_open_foreign_frame())) PL_fail;
+  init_term_encoder(&encoder);
+  rc = write_term_node(&encoder, Term);
+  while (rc && encoder.stack.depth)
+  { struct frame *frame = encoder.stack.frames + encoder.stack.depth - 1;
+    atom_t name;
+    size_t arity;
+    if (frame->length == 0)
+    { encoder.stack.depth--;
+      if (frame->map) rc = write_term_node(&encoder, frame->tail);
+    } else if (frame->map)
+    { frame->length--;
+      rc = PL_get_list(frame->tail, encoder.child, frame->tail) &&
+           write_term_node(&encoder, encoder.child);
+    } else
+      rc = PL_get_name_arity(frame->tail, &name, &arity) &&
+           PL_get_arg(arity - --frame->length, frame->tail, encoder.child) &&
+           write_term_node(&encoder, encoder.child);
+  }
+  if (rc)
+  { msgpackc_writer_init_sizing(&sizing);
+    msgpackc_write_array(&sizing, encoder.functor_count << 1);
+    msgpackc_write_uint(&sizing, encoder.var_count);
+    rc = (!ext || msgpackc_write_ext_header(writer, type,
+                                            sizing.size + encoder.table.size + encoder.body.size)) &&
+         msgpackc_write_array(writer, encoder.functor_count << 1) &&
+         msgpackc_write_data(writer, encoder.table.bytes, encoder.table.size) &&
+         msgpackc_write_uint(writer, encoder.var_count) &&
+         msgpackc_write_data(writer, encoder.body.bytes, encoder.body.size);
+  } else if (encoder.table.error == MSGPACKC_NO_MEMORY || encoder.body.error == MSGPACKC_NO_MEMORY)
+    msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+  release_term_encoder(&encoder);
+  PL_discard_foreign_frame(fid);
+  return rc;
+}
+
+/*
+ * The term decoder reads the functor table up front but makes no atom
+ * or functor for an entry until some node uses it, and then only once
+ * the node's length matches the entry's arity. Untrusted payloads
+ * cannot therefore mint functors that no node could ever hold.
+ *
+ * Decoding stays within the budgets of the enclosing decoder: nesting
+ * counts towards max_depth from the depth of the ext itself; lists and
+ * compound arguments count towards max_elements; strings and names
+ * count towards max_str_bytes.
+ */
+struct term_name
+{ const uint8_t *chars;
+  size_t length;
+  size_t arity;
+  atom_t name;
+  functor_t functor;
+};
+
+struct term_decoder
+{ struct msgpackc_reader reader;
+  struct stack stack;
+  const struct options *options;
+  size_t depth;
+  size_t *elements;
+  struct term_name *names;
+  size_t name_count;
+  term_t vars;
+  uint64_t var_count;
+  term_t child;
+};
+
+static int
+read_term_uint(struct term_decoder *decoder, uint64_t *value)
+{ struct msgpackc_object object;
+  if (!msgpackc_read(&decoder->reader, &object) || object.type != MSGPACKC_UINT) PL_fail;
+  *value = object.value.uint_value;
+  PL_succeed;
+}
+
+static int
+read_term_str(struct term_decoder *decoder, const struct msgpackc_object *object)
+{ size_t max_str_bytes = decoder->options->max_str_bytes;
+  if (object->type != MSGPACKC_STR) PL_fail;
+  if (object->length > max_str_bytes) return budget_error("max_str_bytes", max_str_bytes);
+  PL_succeed;
+}
+
+/*
+ * Answers true if at least count more bytes remain, one for each
+ * element still to read.
+ */
+static int
+read_term_fits(struct term_decoder *decoder, uint64_t count)
+{ return count <= decoder->reader.size - decoder->reader.offset;
+}
+
+/*
+ * Pushes a frame for the elements of a list or the arguments of a
+ * compound, counting them and the frame against the budgets.
+ */
+static int
+read_term_frame(struct term_decoder *decoder, term_t Term, size_t length, int list)
+{ size_t max_depth = decoder->options->max_depth;
+  if (decoder->depth + decoder->stack.depth >= max_depth)
+    return budget_error("max_depth", max_depth);
+  return count_elements(decoder->options->max_elements, decoder->elements, length) &&
+         push_term_frame(&decoder->stack, Term, length, list);
+}
+
+static int
+read_term_functor(struct term_decoder *decoder, struct term_name *name, term_t Term)
+{ if (!name->name &&
+      !(name->name = PL_new_atom_mbchars(REP_UTF8, name->length, (const char *)name->chars)))
+    PL_fail;
+  if (name->arity == 0) return PL_unify_atom(Term, name->name);
+  if (!name->functor && !(name->functor = PL_new_functor(name->name, name->arity))) PL_fail;
+  return PL_unify_functor(Term, name->functor) &&
+         read_term_frame(decoder, Term, name->arity, FALSE);
+}
+
+static int
+read_term_node(struct term_decoder *decoder, term_t Term)
+{ struct msgpackc_object object;
+  uint64_t index;
+  if (!msgpackc_read(&decoder->reader, &object)) PL_fail;
+  switch (object.type)
+  { case MSGPACKC_INT:
+      return PL_unify_int64(Term, object.value.int_value);
+    case MSGPACKC_UINT:
+      return PL_unify_uint64(Term, object.value.uint_value);
+    case MSGPACKC_FLOAT:
+      return PL_unify_float(Term, object.value.float_value);
+    case MSGPACKC_STR:
+      return read_term_str(decoder, &object) &&
+             PL_unify_chars(Term, PL_STRING|REP_UTF8, object.length, (const char *)object.data);
+    case MSGPACKC_ARRAY:
+      if (object.length == 0 || !read_term_fits(decoder, object.length) ||
+          !read_term_uint(decoder, &index)) PL_fail;
+      switch (index)
+      { case TERM_LIST:
+          return object.length >= 2 &&
+                 read_term_frame(decoder, Term, object.length - 2, TRUE);
+        case TERM_VAR:
+          return object.length == 2 &&
+                 read_term_uint(decoder, &index) && index < decoder->var_count &&
+                 PL_unify(Term, decoder->vars + index);
+        case TERM_NIL:
+          return object.length == 1 && PL_unify_nil(Term);
+      }
+      if ((index -= TERM_FUNCTORS) >= decoder->name_count ||
+          object.length != 1 + decoder->names[index].arity) PL_fail;
+      return read_term_functor(decoder, decoder->names + index, Term);
+    default:
+      PL_fail;
+  }
+}
+
+/*
+ * Unifies Term with the Prolog term ext payload of the given length,
+ * within the budgets of options, starting at depth and adding to the
+ * running count of elements. Fails for malformed payloads.
+ *
+ * Every functor table entry needs its arity in bytes or more to follow
+ * it, else no node could use it. The table holds names and arities
+ * only; atoms and functors come later, see read_term_functor().
+ */
+static int
+read_term(term_t Term, const uint8_t *bytes, size_t length,
+          const struct options *options, size_t depth, size_t *elements)
+{ struct term_decoder decoder;
+  struct msgpackc_object object;
+  size_t index = 0;
+  uint64_t value;
+  int rc;
+  msgpackc_reader_init(&decoder.reader, bytes, length);
+  init_stack(&decoder.stack);
+  decoder.options = options;
+  decoder.depth = depth;
+  decoder.elements = elements;
+  decoder.names = NULL;
+  decoder.name_count = 0;
+  decoder.child = PL_new_term_ref();
+  rc = msgpackc_read(&decoder.reader, &object) &&
+       object.type == MSGPACKC_ARRAY && (object.length & 1) == 0 &&
+       read_term_fits(&decoder, object.length) &&
+       count_elements(options->max_elements, elements, object.length);
+  if (rc && (decoder.name_count = object.length >> 1) &&
+      !(decoder.names = calloc(decoder.name_count, sizeof(*decoder.names))))
+    rc = PL_resource_error("memory");
+  for (; rc && index < decoder.name_count; index++)
+  { struct term_name *name = decoder.names + index;
+    if (!(rc = msgpackc_read(&decoder.reader, &object) && read_term_str(&decoder, &object) &&
+               read_term_uint(&decoder, &value) && read_term_fits(&decoder, value))) break;
+    name->chars = object.data;
+    name->length = object.length;
+    name->arity = value;
+  }
+  rc = rc && read_term_uint(&decoder, &decoder.var_count) &&
+       read_term_fits(&decoder, decoder.var_count) &&
+       (decoder.vars = PL_new_term_refs(decoder.var_count ? decoder.var_count : 1)) &&
+       read_term_node(&decoder, Term);
+  while (rc && decoder.stack.depth)
+  { struct frame *frame = decoder.stack.frames + decoder.stack.depth - 1;
+    atom_t name;
+    size_t arity;
+    if (frame->length == 0)
+    { decoder.stack.depth--;
+      if (frame->map) rc = read_term_node(&decoder, frame->tail);
+    } else if (frame->map)
+    { frame->length--;
+      rc = PL_unify_list(frame->tail, decoder.child, frame->tail) &&
+           read_term_node(&decoder, decoder.child);
+    } else
+      rc = PL_get_name_arity(frame->tail, &name, &arity) &&
+           PL_get_arg(arity - --frame->length, frame->tail, decoder.child) &&
+           read_term_node(&decoder, decoder.child);
+  }
+  rc = rc && decoder.reader.offset == length;
+  for (index = 0; index < decoder.name_count; index++)
+    if (decoder.names[index].name) PL_unregister_atom(decoder.names[index].name);
+  free(decoder.names);
+  release_stack(&decoder.stack);
+  return rc;
+}
+
+static int
+encode_term_ext(term_t Term, struct msgpackc_writer *writer, void *closure)
+{ term_t Arg = PL_new_term_ref();
+  return PL_get_arg(1, Term, Arg) && write_term(writer, Arg, (int8_t)(intptr_t)closure, TRUE);
+}
+
+static int
+decode_term_ext(term_t Term, const uint8_t *bytes, size_t length, void *closure)
+{ term_t Arg = PL_new_term_ref();
+  struct options options;
+  size_t elements = 0;
+  (void)closure;
+  init_options(&options);
+  return PL_unify_functor(Term, FUNCTOR_term1) &&
+         PL_get_arg(1, Term, Arg) &&
+         read_term(Arg, bytes, length, &options, 0, &elements);
+}
+
+/*
+ * Decodes a Prolog term ext met by msgpack_decode/3 and its kin, within
+ * the budgets of the decoder.
+ */
+static int
+decode_term_ext_bounded(struct decoder *decoder, term_t Term, const uint8_t *bytes, size_t length)
+{ term_t Arg = PL_new_term_ref();
+  return PL_unify_functor(Term, FUNCTOR_term1) &&
+         PL_get_arg(1, Term, Arg) &&
+         read_term(Arg, bytes, length, decoder->options, decoder->stack.depth, &decoder->elements);
+}
+
+/*
+ * register_term_ext(+Type)
+ *
+ * Registers the native Prolog term codec for Type.
+ */
+static foreign_t
+register_term_ext_1(term_t Type)
+{ struct msgpackc_ext_codec codec = { 0 };
+  int type;
+  if (!PL_get_integer_ex(Type, &type)) PL_fail;
+  if (type < INT8_MIN || type > INT8_MAX) return PL_domain_error("msgpack_ext_type", Type);
+  codec.functor = FUNCTOR_term1;
+  codec.encode = encode_term_ext;
+  codec.decode = decode_term_ext;
+  codec.closure = (void *)(intptr_t)type;
+  register_ext(type, &codec, decode_term_ext_bounded, NULL);
+  PL_succeed;
+}
+
+/*
+ * term_ext(?Term, ?Bytes)
+ *
+ * Decodes the payload Bytes of a Prolog term ext when Bytes is a proper
+ * list, else encodes term(T) as payload Bytes. Serves the msgpack//1
+ * grammar, by way of the closure that msgpack_register_term_ext/1
+ * registers.
+ */
+static foreign_t
+term_ext_2(term_t Term, term_t Bytes)
+{ struct msgpackc_writer writer;
+  term_t Arg = PL_new_term_ref();
+  size_t length;
+  int rc;
+  if (PL_skip_list(Bytes, 0, &length) == PL_LIST)
+  { term_t Nil = PL_new_term_ref();
+    uint8_t *bytes = malloc(length ? length : 1);
+    if (bytes == NULL) return PL_resource_error("memory");
+    rc = PL_put_nil(Nil) && get_list_bytes(Bytes, Nil, length, bytes) &&
+         decode_term_ext(Term, bytes, length, NULL);
+    free(bytes);
+    return rc;
+  }
+  if (!PL_is_functor(Term, FUNCTOR_term1) || !PL_get_arg(1, Term, Arg)) PL_fail;
+  msgpackc_writer_init(&writer);
+  rc = write_term(&writer, Arg, 0, FALSE) || writer_error(&writer);
+  rc = rc && PL_unify_chars(Bytes, PL_CODE_LIST, writer.size, (const char *)writer.bytes);
+  msgpackc_writer_release(&writer);
+  return rc;
+}
+
+install_t install_msgpackc()
+{
+#ifdef MSGPACKC_STATISTICS
+  pthread_key_create(&statistics_key, release_statistics);
+  PL_set_prolog_flag("msgpackc_statistics", PL_BOOL, TRUE);
+#endif
+  ATOM_nil = PL_new_atom("nil");
+  ATOM_false = PL_new_atom("false");
+  ATOM_true = PL_new_atom("true");
+  ATOM_max_depth = PL_new_atom("max_depth");
+  ATOM_max_elements = PL_new_atom("max_elements");
+  ATOM_max_str_bytes = PL_new_atom("max_str_bytes");
+  ATOM_max_total_bytes = PL_new_atom("max_total_bytes");
+  ATOM_strict = PL_new_atom("strict");
+  ATOM_timestamp = PL_new_atom("timestamp");
+  ATOM_epoch = PL_new_atom("epoch");
+  ATOM_sec_nsec = PL_new_atom("sec_nsec");
+  ATOM_share = PL_new_atom("share");
+  FUNCTOR_bool1 = PL_new_functor(PL_new_atom("bool"), 1);
+  FUNCTOR_int1 = PL_new_functor(PL_new_atom("int"), 1);
+  FUNCTOR_float1 = PL_new_functor(PL_new_atom("float"), 1);
+  FUNCTOR_str1 = PL_new_functor(PL_new_atom("str"), 1);
+  FUNCTOR_bin1 = PL_new_functor(PL_new_atom("bin"), 1);
+  FUNCTOR_array1 = PL_new_functor(PL_new_atom("array"), 1);
+  FUNCTOR_map1 = PL_new_functor(PL_new_atom("map"), 1);
+  FUNCTOR_minus2 = PL_new_functor(PL_new_atom("-"), 2);
+  FUNCTOR_divide2 = PL_new_functor(PL_new_atom("/"), 2);
+  FUNCTOR_timestamp1 = PL_new_functor(ATOM_timestamp, 1);
+  FUNCTOR_timestamp2 = PL_new_functor(ATOM_timestamp, 2);
+  FUNCTOR_term1 = PL_new_functor(PL_new_atom("term"), 1);
+  FUNCTOR_msgpackc_var2 = PL_new_functor(PL_new_atom("$msgpackc_var"), 2);
+  PREDICATE_ext_dispatch3 = PL_predicate("ext_dispatch", 3, "msgpackc");
+#if defined(MSGPACKC_GMP) && defined(MSGPACKC_BIGNUM_TYPE)
+  register_bignum_ext(MSGPACKC_BIGNUM_TYPE);
+#endif
+  PL_register_foreign("float32", 3, float32_3, 0);
   PL_register_foreign("float64", 3, float64_3, 0);
   PL_register_foreign("uint16", 3, uint16_3, 0);
   PL_register_foreign("uint32", 3, uint32_3, 0);
@@ -311,6 +3124,24 @@ install_t install_msgpackc()
   PL_register_foreign("int16", 3, int16_3, 0);
   PL_register_foreign("int32", 3, int32_3, 0);
   PL_register_foreign("int64", 3, int64_3, 0);
+  PL_register_foreign("register_ext", 3, register_ext_3, 0);
+  PL_register_foreign("register_term_ext", 1, register_term_ext_1, 0);
+  PL_register_foreign("register_bignum_ext", 1, register_bignum_ext_1, 0);
+  PL_register_foreign("term_ext", 2, term_ext_2, 0);
+  PL_register_foreign("msgpack_codec_create", 2, msgpack_codec_create_2, 0);
+  PL_register_foreign("msgpack_statistics", 1, msgpack_statistics_1, 0);
+  PL_register_foreign("msgpack_latency", 1, msgpack_latency_1, 0);
+  PL_register_foreign("msgpack_thread_allocated", 1, msgpack_thread_allocated_1, 0);
+  PL_register_foreign("msgpack_reset_statistics", 0, msgpack_reset_statistics_0, 0);
+  PL_register_foreign("msgpack_decode", 4, msgpack_decode_4, 0);
+  PL_register_foreign("msgpack_decode_all", 3, msgpack_decode_all_3, 0);
+  PL_register_foreign("msgpack_encode", 4, msgpack_encode_4, 0);
+  PL_register_foreign("msgpack_encode_all", 3, msgpack_encode_all_3, 0);
+  PL_register_foreign("msgpack_size", 3, msgpack_size_3, 0);
+  PL_register_foreign("msgpack_buffer_create", 2, msgpack_buffer_create_2, 0);
+  PL_register_foreign("msgpack_buffer_size", 2, msgpack_buffer_size_2, 0);
+  PL_register_foreign("msgpack_buffer_bytes", 4, msgpack_buffer_bytes_4, 0);
+  PL_register_foreign("msgpack_encode_into", 5, msgpack_encode_into_5, 0);
 }
 
 install_t uninstall_msgpackc()
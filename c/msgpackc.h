@@ -0,0 +1,629 @@
+/*  File:    msgpackc.h
+    Author:  msgpackc contributors
+    Created: Oct 17 2026
+    Purpose: C-Based MessagePack writer and reader
+
+Copyright (c) 2022, Roy Ratcliffe, Northumberland, United Kingdom
+Copyright (c) 2026, msgpackc contributors
+
+The writer derives from the encoder in msgpackc.c by Roy Ratcliffe.
+
+Permission is hereby granted, free of charge,  to any person obtaining a
+copy  of  this  software  and    associated   documentation  files  (the
+"Software"), to deal in  the   Software  without  restriction, including
+without limitation the rights to  use,   copy,  modify,  merge, publish,
+distribute, sublicense, and/or sell  copies  of   the  Software,  and to
+permit persons to whom the Software is   furnished  to do so, subject to
+the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT  WARRANTY OF ANY KIND, EXPRESS
+OR  IMPLIED,  INCLUDING  BUT  NOT   LIMITED    TO   THE   WARRANTIES  OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR   PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS  OR   COPYRIGHT  HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER   IN  AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM,  OUT  OF   OR  IN  CONNECTION  WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef MSGPACKC_H
+#define MSGPACKC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+MessagePack for C without Prolog. Header only; every function is static
+inline. The msgpackc foreign library encodes through this same writer,
+so bytes written here decode with msgpack//1 and msgpack_decode//1
+exactly as if Prolog had encoded them, and the other way around.
+
+A writer writes into a growable buffer, a fixed caller-supplied buffer,
+or nowhere at all when only sizing. Functions answer non-zero on
+success. On failure they answer zero and record the reason in the
+writer's error field: out of memory, overflow of a fixed buffer, or a
+length beyond 32 bits.
+
+    struct msgpackc_writer writer;
+    msgpackc_writer_init(&writer);
+    msgpackc_write_map(&writer, 1);
+    msgpackc_write_str(&writer, "answer", 6);
+    msgpackc_write_int(&writer, 42);
+    ... use writer.bytes and writer.size ...
+    msgpackc_writer_release(&writer);
+
+A reader iterates over the objects in a block of bytes, depth first. An
+array or map header reports its length; its elements or key-value
+pairs follow as the next objects. Str, bin and ext objects point into
+the block rather than copying.
+
+Hook macros MSGPACKC_WROTE_FORMAT, MSGPACKC_WROTE_DATA and
+MSGPACKC_ALLOCATED observe the writer. They default to nothing. The
+foreign library defines them for its statistics and tracepoints.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifndef MSGPACKC_WROTE_FORMAT
+#define MSGPACKC_WROTE_FORMAT(writer, format) ((void)0)
+#endif
+#ifndef MSGPACKC_WROTE_DATA
+#define MSGPACKC_WROTE_DATA(writer, count) ((void)0)
+#endif
+#ifndef MSGPACKC_ALLOCATED
+#define MSGPACKC_ALLOCATED(writer, capacity) ((void)0)
+#endif
+
+#define MSGPACKC_WRITER_BUFFER 256
+
+enum msgpackc_error
+{ MSGPACKC_OK,
+  MSGPACKC_NO_MEMORY,
+  MSGPACKC_OVERFLOW,
+  MSGPACKC_TOO_LONG,
+  MSGPACKC_TRUNCATED,
+  MSGPACKC_INVALID
+};
+
+struct msgpackc_writer
+{ uint8_t *bytes;
+  size_t size;
+  size_t capacity;
+  int fixed;
+  int error;
+  uint8_t format;
+  uint8_t buffer[MSGPACKC_WRITER_BUFFER];
+};
+
+/*
+ * Initialises a growable writer. Small messages fit in the writer's own
+ * buffer; larger ones move to the heap.
+ */
+static inline void
+msgpackc_writer_init(struct msgpackc_writer *writer)
+{ writer->bytes = writer->buffer;
+  writer->size = 0;
+  writer->capacity = sizeof(writer->buffer);
+  writer->fixed = 0;
+  writer->error = MSGPACKC_OK;
+}
+
+/*
+ * Initialises a sizing writer. It stores nothing, only counts the
+ * bytes that it would write.
+ */
+static inline void
+msgpackc_writer_init_sizing(struct msgpackc_writer *writer)
+{ writer->bytes = NULL;
+  writer->size = 0;
+  writer->capacity = 0;
+  writer->fixed = 0;
+  writer->error = MSGPACKC_OK;
+}
+
+/*
+ * Initialises a fixed writer over capacity bytes belonging to the
+ * caller. Writing beyond them fails with MSGPACKC_OVERFLOW.
+ */
+static inline void
+msgpackc_writer_init_fixed(struct msgpackc_writer *writer, uint8_t *bytes, size_t capacity)
+{ writer->bytes = bytes;
+  writer->size = 0;
+  writer->capacity = capacity;
+  writer->fixed = 1;
+  writer->error = MSGPACKC_OK;
+}
+
+static inline void
+msgpackc_writer_release(struct msgpackc_writer *writer)
+{ if (!writer->fixed && writer->bytes && writer->bytes != writer->buffer) free(writer->bytes);
+}
+
+static inline int
+msgpackc_writer_fail(struct msgpackc_writer *writer, int error)
+{ writer->error = error;
+  return 0;
+}
+
+/*
+ * Makes room for count more bytes.
+ */
+static inline int
+msgpackc_writer_grow(struct msgpackc_writer *writer, size_t count)
+{ size_t capacity = writer->capacity;
+  uint8_t *bytes;
+  if (writer->fixed) return msgpackc_writer_fail(writer, MSGPACKC_OVERFLOW);
+  if (count > SIZE_MAX - writer->size) return msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+  while (capacity < writer->size + count)
+  { if (capacity > SIZE_MAX >> 1) return msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+    capacity <<= 1;
+  }
+  if (writer->bytes == writer->buffer)
+  { if ((bytes = malloc(capacity))) memcpy(bytes, writer->buffer, writer->size);
+  } else bytes = realloc(writer->bytes, capacity);
+  if (bytes == NULL) return msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+  MSGPACKC_ALLOCATED(writer, capacity);
+  writer->bytes = bytes;
+  writer->capacity = capacity;
+  return 1;
+}
+
+/*
+ * Reserves count bytes and answers their address, or NULL if the
+ * writer cannot make room. Never call for a sizing writer.
+ */
+static inline uint8_t *
+msgpackc_write_bytes(struct msgpackc_writer *writer, size_t count)
+{ uint8_t *bytes;
+  if (count > writer->capacity - writer->size && !msgpackc_writer_grow(writer, count)) return NULL;
+  bytes = writer->bytes + writer->size;
+  writer->size += count;
+  return bytes;
+}
+
+/*
+ * Counts count bytes without writing them.
+ */
+static inline int
+msgpackc_write_size(struct msgpackc_writer *writer, size_t count)
+{ if (count > SIZE_MAX - writer->size) return msgpackc_writer_fail(writer, MSGPACKC_NO_MEMORY);
+  writer->size += count;
+  return 1;
+}
+
+/*
+ * Writes the payload of a str, bin or ext object.
+ */
+static inline int
+msgpackc_write_data(struct msgpackc_writer *writer, const void *data, size_t count)
+{ uint8_t *bytes;
+  if (writer->bytes == NULL) return msgpackc_write_size(writer, count);
+  if (!(bytes = msgpackc_write_bytes(writer, count))) return 0;
+  memcpy(bytes, data, count);
+  MSGPACKC_WROTE_DATA(writer, count);
+  return 1;
+}
+
+/*
+ * Writes a format byte followed by a big-endian value of width bytes.
+ * Width zero writes the format byte alone. Every object begins with
+ * exactly one format byte; only the type byte of an ext object does
+ * not pass through here.
+ */
+static inline int
+msgpackc_write_format(struct msgpackc_writer *writer, uint8_t format, size_t width, uint64_t value)
+{ uint8_t *bytes;
+  if (writer->bytes == NULL) return msgpackc_write_size(writer, 1 + width);
+  if (!(bytes = msgpackc_write_bytes(writer, 1 + width))) return 0;
+  *bytes++ = format;
+  while (width--) *bytes++ = value >> (width << 3);
+  writer->format = format;
+  MSGPACKC_WROTE_FORMAT(writer, format);
+  return 1;
+}
+
+static inline int
+msgpackc_write_type(struct msgpackc_writer *writer, int8_t type)
+{ uint8_t *bytes;
+  if (writer->bytes == NULL) return msgpackc_write_size(writer, 1);
+  if (!(bytes = msgpackc_write_bytes(writer, 1))) return 0;
+  *bytes = (uint8_t)type;
+  return 1;
+}
+
+/*
+ * Writes a format header for a length. The three formats in each family
+ * use 8, 16 and 32 bits, in that order. Fixed formats pass zero as
+ * their format when the family has no 8-bit length.
+ */
+static inline int
+msgpackc_write_length(struct msgpackc_writer *writer, uint8_t format8, uint8_t format16, uint8_t format32, size_t length)
+{ if (length <= UINT8_MAX && format8) return msgpackc_write_format(writer, format8, 1, length);
+  if (length <= UINT16_MAX) return msgpackc_write_format(writer, format16, 2, length);
+  if (length <= UINT32_MAX) return msgpackc_write_format(writer, format32, 4, length);
+  return msgpackc_writer_fail(writer, MSGPACKC_TOO_LONG);
+}
+
+static inline int
+msgpackc_write_nil(struct msgpackc_writer *writer)
+{ return msgpackc_write_format(writer, 0xc0, 0, 0);
+}
+
+static inline int
+msgpackc_write_bool(struct msgpackc_writer *writer, int value)
+{ return msgpackc_write_format(writer, value ? 0xc3 : 0xc2, 0, 0);
+}
+
+/*
+ * Writes an unsigned integer in the fewest bytes. Fixints cover zero
+ * through 127.
+ */
+static inline int
+msgpackc_write_uint(struct msgpackc_writer *writer, uint64_t value)
+{ if (value <= 127) return msgpackc_write_format(writer, value, 0, 0);
+  if (value <= UINT8_MAX) return msgpackc_write_format(writer, 0xcc, 1, value);
+  if (value <= UINT16_MAX) return msgpackc_write_format(writer, 0xcd, 2, value);
+  if (value <= UINT32_MAX) return msgpackc_write_format(writer, 0xce, 4, value);
+  return msgpackc_write_format(writer, 0xcf, 8, value);
+}
+
+/*
+ * Writes a signed integer in the fewest bytes. Non-negative integers
+ * take the unsigned formats; negative fixints cover -32 through -1.
+ */
+static inline int
+msgpackc_write_int(struct msgpackc_writer *writer, int64_t value)
+{ if (value >= 0) return msgpackc_write_uint(writer, value);
+  if (value >= -32) return msgpackc_write_format(writer, (uint8_t)value, 0, 0);
+  if (value >= INT8_MIN) return msgpackc_write_format(writer, 0xd0, 1, value);
+  if (value >= INT16_MIN) return msgpackc_write_format(writer, 0xd1, 2, value);
+  if (value >= INT32_MIN) return msgpackc_write_format(writer, 0xd2, 4, value);
+  return msgpackc_write_format(writer, 0xd3, 8, value);
+}
+
+/*
+ * Writes a double as float32 when narrowing loses nothing, that is
+ * when the low 32 bits of the double are all zero, else as float64.
+ */
+static inline int
+msgpackc_write_float(struct msgpackc_writer *writer, double value)
+{ union { double value; uint64_t bits; } xxxxxxxx;
+  union { float value; uint32_t bits; } xxxx;
+  xxxxxxxx.value = value;
+  if (xxxxxxxx.bits & UINT32_MAX) return msgpackc_write_format(writer, 0xcb, 8, xxxxxxxx.bits);
+  xxxx.value = value;
+  return msgpackc_write_format(writer, 0xca, 4, xxxx.bits);
+}
+
+static inline int
+msgpackc_write_str_header(struct msgpackc_writer *writer, size_t length)
+{ if (length <= 31) return msgpackc_write_format(writer, 0xa0 | length, 0, 0);
+  return msgpackc_write_length(writer, 0xd9, 0xda, 0xdb, length);
+}
+
+/*
+ * Writes a str of length bytes of UTF-8, unchecked.
+ */
+static inline int
+msgpackc_write_str(struct msgpackc_writer *writer, const char *chars, size_t length)
+{ return msgpackc_write_str_header(writer, length) &&
+         msgpackc_write_data(writer, chars, length);
+}
+
+static inline int
+msgpackc_write_bin_header(struct msgpackc_writer *writer, size_t length)
+{ return msgpackc_write_length(writer, 0xc4, 0xc5, 0xc6, length);
+}
+
+static inline int
+msgpackc_write_bin(struct msgpackc_writer *writer, const void *bytes, size_t length)
+{ return msgpackc_write_bin_header(writer, length) &&
+         msgpackc_write_data(writer, bytes, length);
+}
+
+/*
+ * Writes the header of an array of length elements. The elements
+ * follow as the next length objects.
+ */
+static inline int
+msgpackc_write_array(struct msgpackc_writer *writer, size_t length)
+{ if (length <= 15) return msgpackc_write_format(writer, 0x90 | length, 0, 0);
+  return msgpackc_write_length(writer, 0, 0xdc, 0xdd, length);
+}
+
+/*
+ * Writes the header of a map of length pairs. The pairs follow as the
+ * next length times two objects, key then value.
+ */
+static inline int
+msgpackc_write_map(struct msgpackc_writer *writer, size_t length)
+{ if (length <= 15) return msgpackc_write_format(writer, 0x80 | length, 0, 0);
+  return msgpackc_write_length(writer, 0, 0xde, 0xdf, length);
+}
+
+/*
+ * Writes the header of an ext object, choosing fixext for lengths of
+ * one, two, four, eight and sixteen bytes.
+ */
+static inline int
+msgpackc_write_ext_header(struct msgpackc_writer *writer, int8_t type, size_t length)
+{ int rc;
+  switch (length)
+  { case 1:
+      rc = msgpackc_write_format(writer, 0xd4, 0, 0);
+      break;
+    case 2:
+      rc = msgpackc_write_format(writer, 0xd5, 0, 0);
+      break;
+    case 4:
+      rc = msgpackc_write_format(writer, 0xd6, 0, 0);
+      break;
+    case 8:
+      rc = msgpackc_write_format(writer, 0xd7, 0, 0);
+      break;
+    case 16:
+      rc = msgpackc_write_format(writer, 0xd8, 0, 0);
+      break;
+    default:
+      rc = msgpackc_write_length(writer, 0xc7, 0xc8, 0xc9, length);
+  }
+  return rc && msgpackc_write_type(writer, type);
+}
+
+static inline int
+msgpackc_write_ext(struct msgpackc_writer *writer, int8_t type, const void *bytes, size_t length)
+{ return msgpackc_write_ext_header(writer, type, length) &&
+         msgpackc_write_data(writer, bytes, length);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+enum msgpackc_type
+{ MSGPACKC_NIL,
+  MSGPACKC_BOOL,
+  MSGPACKC_INT,
+  MSGPACKC_UINT,
+  MSGPACKC_FLOAT,
+  MSGPACKC_STR,
+  MSGPACKC_BIN,
+  MSGPACKC_ARRAY,
+  MSGPACKC_MAP,
+  MSGPACKC_EXT
+};
+
+/*
+ * One object. Integers take int for negatives and uint otherwise.
+ * Length counts the bytes of str, bin and ext payloads, the elements
+ * of arrays and the pairs of maps. Data points at the payload.
+ */
+struct msgpackc_object
+{ enum msgpackc_type type;
+  uint8_t format;
+  union
+  { int boolean;
+    int64_t int_value;
+    uint64_t uint_value;
+    double float_value;
+  } value;
+  size_t length;
+  int8_t ext_type;
+  const uint8_t *data;
+};
+
+struct msgpackc_reader
+{ const uint8_t *bytes;
+  size_t size;
+  size_t offset;
+  int error;
+};
+
+static inline void
+msgpackc_reader_init(struct msgpackc_reader *reader, const void *bytes, size_t size)
+{ reader->bytes = bytes;
+  reader->size = size;
+  reader->offset = 0;
+  reader->error = MSGPACKC_OK;
+}
+
+static inline int
+msgpackc_reader_fail(struct msgpackc_reader *reader, int error)
+{ reader->error = error;
+  return 0;
+}
+
+/*
+ * Reads a big-endian value of width bytes.
+ */
+static inline int
+msgpackc_read_value(struct msgpackc_reader *reader, size_t width, uint64_t *value)
+{ const uint8_t *bytes = reader->bytes + reader->offset;
+  if (width > reader->size - reader->offset) return msgpackc_reader_fail(reader, MSGPACKC_TRUNCATED);
+  reader->offset += width;
+  *value = 0;
+  while (width--) *value = *value << 8 | *bytes++;
+  return 1;
+}
+
+static inline int
+msgpackc_read_payload(struct msgpackc_reader *reader, struct msgpackc_object *object)
+{ if (object->length > reader->size - reader->offset) return msgpackc_reader_fail(reader, MSGPACKC_TRUNCATED);
+  object->data = reader->bytes + reader->offset;
+  reader->offset += object->length;
+  return 1;
+}
+
+static inline int
+msgpackc_read_length(struct msgpackc_reader *reader, size_t width, struct msgpackc_object *object)
+{ uint64_t length;
+  if (!msgpackc_read_value(reader, width, &length)) return 0;
+  object->length = length;
+  return 1;
+}
+
+/*
+ * Reads the next object. Answers zero at the end of the bytes, with
+ * error MSGPACKC_OK, or for truncated or invalid bytes, with the error
+ * set accordingly. The offset stays at the start of a failed object.
+ */
+static inline int
+msgpackc_read(struct msgpackc_reader *reader, struct msgpackc_object *object)
+{ size_t offset = reader->offset;
+  uint64_t value;
+  uint8_t format;
+  int rc = 1;
+  if (reader->offset == reader->size) return msgpackc_reader_fail(reader, MSGPACKC_OK);
+  object->format = format = reader->bytes[reader->offset++];
+  object->length = 0;
+  object->data = NULL;
+  if (format <= 0x7f)
+  { object->type = MSGPACKC_UINT;
+    object->value.uint_value = format;
+  } else if (format >= 0xe0)
+  { object->type = MSGPACKC_INT;
+    object->value.int_value = (int8_t)format;
+  } else if (format <= 0x8f)
+  { object->type = MSGPACKC_MAP;
+    object->length = format & 0x0f;
+  } else if (format <= 0x9f)
+  { object->type = MSGPACKC_ARRAY;
+    object->length = format & 0x0f;
+  } else if (format <= 0xbf)
+  { object->type = MSGPACKC_STR;
+    object->length = format & 0x1f;
+    rc = msgpackc_read_payload(reader, object);
+  } else switch (format)
+  { case 0xc0:
+      object->type = MSGPACKC_NIL;
+      break;
+    case 0xc2:
+    case 0xc3:
+      object->type = MSGPACKC_BOOL;
+      object->value.boolean = format & 1;
+      break;
+    case 0xc4:
+    case 0xc5:
+    case 0xc6:
+      object->type = MSGPACKC_BIN;
+      rc = msgpackc_read_length(reader, 1 << (format - 0xc4), object) &&
+           msgpackc_read_payload(reader, object);
+      break;
+    case 0xc7:
+    case 0xc8:
+    case 0xc9:
+      object->type = MSGPACKC_EXT;
+      rc = msgpackc_read_length(reader, 1 << (format - 0xc7), object) &&
+           msgpackc_read_value(reader, 1, &value) &&
+           msgpackc_read_payload(reader, object);
+      if (rc) object->ext_type = (int8_t)value;
+      break;
+    case 0xca:
+      object->type = MSGPACKC_FLOAT;
+      if ((rc = msgpackc_read_value(reader, 4, &value)))
+      { union { uint32_t bits; float value; } xxxx;
+        xxxx.bits = value;
+        object->value.float_value = xxxx.value;
+      }
+      break;
+    case 0xcb:
+      object->type = MSGPACKC_FLOAT;
+      if ((rc = msgpackc_read_value(reader, 8, &value)))
+      { union { uint64_t bits; double value; } xxxxxxxx;
+        xxxxxxxx.bits = value;
+        object->value.float_value = xxxxxxxx.value;
+      }
+      break;
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+      object->type = MSGPACKC_UINT;
+      rc = msgpackc_read_value(reader, 1 << (format - 0xcc), &object->value.uint_value);
+      break;
+    case 0xd0:
+    case 0xd1:
+    case 0xd2:
+    case 0xd3:
+    { size_t width = 1 << (format - 0xd0), shift = 64 - (width << 3);
+      object->type = MSGPACKC_INT;
+      if ((rc = msgpackc_read_value(reader, width, &value)))
+        object->value.int_value = (int64_t)(value << shift) >> shift;
+      if (rc && object->value.int_value >= 0)
+      { object->type = MSGPACKC_UINT;
+        object->value.uint_value = object->value.int_value;
+      }
+      break;
+    }
+    case 0xd4:
+    case 0xd5:
+    case 0xd6:
+    case 0xd7:
+    case 0xd8:
+      object->type = MSGPACKC_EXT;
+      object->length = 1 << (format - 0xd4);
+      rc = msgpackc_read_value(reader, 1, &value) &&
+           msgpackc_read_payload(reader, object);
+      if (rc) object->ext_type = (int8_t)value;
+      break;
+    case 0xd9:
+    case 0xda:
+    case 0xdb:
+      object->type = MSGPACKC_STR;
+      rc = msgpackc_read_length(reader, 1 << (format - 0xd9), object) &&
+           msgpackc_read_payload(reader, object);
+      break;
+    case 0xdc:
+    case 0xdd:
+      object->type = MSGPACKC_ARRAY;
+      rc = msgpackc_read_length(reader, 2 << (format - 0xdc), object);
+      break;
+    case 0xde:
+    case 0xdf:
+      object->type = MSGPACKC_MAP;
+      rc = msgpackc_read_length(reader, 2 << (format - 0xde), object);
+      break;
+    default:
+      rc = msgpackc_reader_fail(reader, MSGPACKC_INVALID);
+  }
+  if (!rc) reader->offset = offset;
+  return rc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Native ext codecs for foreign libraries loaded alongside msgpackc. Not
+header only: msgpackc_register_ext() lives in the msgpackc foreign
+library, so needs SWI-Prolog.h and msgpackc loaded first.
+
+Encode writes the whole ext object for Term, header and all, typically
+by msgpackc_write_ext(); it answers zero to fail and fall back to the
+Prolog hook. Decode unifies Term with the object decoded from length
+payload bytes; it answers zero for a payload it rejects, which fails
+decoding or, when strict, raises a syntax error with reason `bad_ext`.
+Both receive the closure given at registration.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef __SWI_PROLOG__
+
+struct msgpackc_ext_codec
+{ functor_t functor;
+  int (*encode)(term_t Term, struct msgpackc_writer *writer, void *closure);
+  int (*decode)(term_t Term, const uint8_t *bytes, size_t length, void *closure);
+  void *closure;
+};
+
+/*
+ * Registers a codec for an ext type, replacing any earlier codec for
+ * the same type. Terms with the codec's functor encode as the type.
+ * Answers zero unless both callbacks are present.
+ */
+extern int msgpackc_register_ext(int8_t type, const struct msgpackc_ext_codec *codec);
+
+#endif
+
+#endif /* MSGPACKC_H */
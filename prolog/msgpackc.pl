@@ -32,6 +32,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
             msgpack_object//1,                  % ?Object
             msgpack_objects//1,                 % ?Objects
 
+            msgpack_codec_create/2,             % +Options,-Codec
+
+            msgpack_decode//1,                  % -Term
+            msgpack_decode//2,                  % -Term,+Options
+            msgpack_encode//1,                  % +Term
+            msgpack_encode//2,                  % +Term,+Options
+            msgpack_decode_all/2,               % +Bytes,-Terms
+            msgpack_decode_all/3,               % +Bytes,-Terms,+Options
+            msgpack_encode_all/2,               % +Terms,-Bytes
+            msgpack_encode_all/3,               % +Terms,-Bytes,+Options
+            msgpack_size/2,                     % +Term,-Size
+            msgpack_size/3,                     % +Term,-Size,+Options
+            msgpack_encode_into/4,              % +Buffer,+Offset0,+Term,-Offset
+            msgpack_encode_into/5,              % +Buffer,+Offset0,+Term,-Offset,+Options
+
+            msgpack_buffer_create/2,            % +Size,-Buffer
+            msgpack_buffer_size/2,              % +Buffer,-Size
+            msgpack_buffer_bytes/4,             % +Buffer,+Offset,+Length,-Bytes
+
+            msgpack_statistics/1,               % -Stats
+            msgpack_latency/1,                  % -Histograms
+            msgpack_latency_percentile/3,       % +Histogram,+Percentile,-Nanoseconds
+            msgpack_thread_allocated/1,         % -Bytes
+            msgpack_accounting/2,               % :Goal,-Usage
+            msgpack_reset_statistics/0,
+
             msgpack_nil//0,
             msgpack_false//0,
             msgpack_true//0,
@@ -63,10 +89,17 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
             % ext format family
             msgpack_ext//1,                     % ?Term
-            msgpack_ext//2                      % ?Type,?Ext
+            msgpack_ext//2,                     % ?Type,?Ext
+            msgpack_register_ext/3,             % +Type,+Name/Arity,:Closure
+            msgpack_register_term_ext/1,        % +Type
+            msgpack_register_bignum_ext/1       % +Type
           ]).
 :- autoload(library(dcg/high_order), [sequence//2, sequence/4]).
 :- autoload(library(utf8), [utf8_codes/3]).
+:- autoload(library(apply), [maplist/4]).
+:- autoload(library(lists), [append/3, sum_list/2]).
+:- autoload(library(pairs), [pairs_values/2]).
+:- autoload(library(error), [must_be/2]).
 
 :- use_foreign_library(foreign(msgpackc)).
 
@@ -99,10 +132,14 @@ improvements might aggregate to milliseconds.
 :- meta_predicate
     msgpack_array(3, ?, ?, ?),
     msgpack_map(3, ?, ?, ?),
-    msgpack_dict(3, ?, ?, ?).
+    msgpack_dict(3, ?, ?, ?),
+    msgpack_accounting(0, -),
+    msgpack_register_ext(+, +, 2).
 
 :- multifile msgpack:type_ext_hook/3.
 
+:- dynamic registered_ext/3.
+
 %!  msgpack(?Term:compound)// is nondet.
 %
 %   Where Term is a compound arity-1 functor, never a list term. The
@@ -111,6 +148,10 @@ improvements might aggregate to milliseconds.
 %   Packing arrays and maps necessarily recurses. Array elements are
 %   themselves objects; arrays are objects hence arrays of arrays
 %   nested up to any number of dimensions. Same goes for maps.
+%
+%   The grammar recurses once per level of nesting. Use
+%   msgpack_decode//1 and msgpack_encode//1 for very deeply nested
+%   terms; they iterate using an explicit heap-allocated stack.
 
 msgpack(nil) --> msgpack_nil, !.
 msgpack(bool(false)) --> msgpack_false, !.
@@ -208,6 +249,281 @@ msgpack_key(Key) -->
 
 msgpack_objects(Objects) --> sequence(msgpack_object, Objects).
 
+%!  msgpack_codec_create(+Options:list, -Codec) is det.
+%
+%   Codec is a blob capturing Options parsed once in advance. Every C
+%   predicate taking Options accepts Codec in their place, and then
+%   spends nothing on option processing. Create a codec once and reuse
+%   it in hot loops; threads can share codecs since codecs never change.
+%   C implements the predicate.
+%
+%   As with library(option), the C predicates ignore options that they
+%   do not know, including terms other than Name(Value). They raise
+%   errors only for a known option with an invalid value, or when
+%   Options is not a proper list.
+
+%!  msgpack_decode(-Term)// is semidet.
+%!  msgpack_decode(-Term, +Options)// is semidet.
+%
+%   Decodes one msgpack//1 Term using the C decoder. Decoding never
+%   back-tracks; the lead byte of each object selects its format
+%   directly. Options bound the work and memory spent on one message:
+%
+%       - max_depth(Depth) limits the nesting of arrays and maps.
+%       - max_elements(Count) limits the total number of objects
+%       including containers; each map pair counts as two.
+%       - max_str_bytes(Bytes) limits the payload of each str, bin or
+%       ext object.
+%       - max_total_bytes(Bytes) limits the length of the message.
+%       - strict(Bool) raises a syntax error for malformed bytes rather
+%       than failing; defaults to `false`.
+%       - timestamp(Form) decodes timestamp ext objects as
+%       timestamp(Epoch) for Form `epoch`, the default, or as
+%       timestamp(Sec, NSec) with integer seconds and nanoseconds for
+%       Form `sec_nsec`. The latter loses no precision.
+%       - share(Type) resolves back-references written by
+%       msgpack_encode//2 with the same option: fixext objects of
+%       extension Type with 1, 2, 4 or 8-byte payloads. Each unifies
+%       with an earlier object of the message, so that the decoded term
+%       shares its subterms, or with an enclosing array or map, making
+%       a cyclic term.
+%
+%   The decoder checks the budgets while reading each header, before
+%   reading any of the elements or payload that the header announces.
+%   It does not recurse. Nested arrays and maps push frames onto an
+%   explicit stack on the heap, so that only the max_depth budget
+%   limits nesting. C implements the arity-2 grammar.
+%
+%   Strict decoding stops at the first malformed byte. The syntax error
+%   carries one of the following reasons together with the byte offset
+%   from the start of the message.
+%
+%       - `invalid_lead_byte` for the never-used format byte 0xc1.
+%       - `truncated` when the bytes end before the object does.
+%       - `not_a_byte` for list elements outside 0 through 255.
+%       - `bad_utf8` for str payloads that are not valid UTF-8.
+%       - `bad_timestamp` for timestamp payloads of the wrong length or
+%       with nanoseconds above 999,999,999.
+%       - `bad_ext` for ext payloads that their registered native codec
+%       rejects, e.g. a bignum with leading zero bytes.
+%       - `bad_reference` for back-references, when sharing, to
+%       objects not yet decoded.
+%
+%   @error resource_error(msgpack_budget(Budget, Limit)) when the
+%   message exceeds one of the budgets.
+%   @error syntax_error(msgpack(Reason, Offset)) for malformed bytes
+%   when strict.
+
+msgpack_decode(Term) --> msgpack_decode(Term, []).
+
+%!  msgpack_encode(+Term)// is semidet.
+%!  msgpack_encode(+Term, +Options)// is semidet.
+%
+%   Encodes one msgpack//1 Term using the C encoder. Selects the same
+%   formats as msgpack//1 for the same Term, and likewise passes
+%   non-standard terms to the msgpack:type_ext_hook/3 hook. Encoding
+%   iterates the same way as msgpack_decode//2 does. Of the decoding
+%   Options, only max_depth(Depth) applies. A cyclic Term raises a type
+%   error, unless sharing, once it nests 1,024 deep or meets max_depth,
+%   whichever comes first.
+%
+%   Option share(Type) writes each str, bin, array, map or ext object
+%   that repeats the bytes of an earlier object in the same message as
+%   a back-reference instead, an ext of the given Type whose payload
+%   numbers the earlier object. An array or map nested within itself
+%   likewise becomes a reference to its open ancestor, so that cyclic
+%   terms encode without exhausting max_depth. Objects of three bytes
+%   or fewer never share. Decoding needs the same option; peers that
+%   know nothing of the convention see the references as ordinary ext
+%   objects. Choose a Type that no other extension uses.
+%   Sharing costs time quadratic in the depth of Term, since each
+%   container hashes all the bytes nested within it; max_depth bounds
+%   the cost.
+%
+%   Encodes timestamp(Epoch) and timestamp(Sec, NSec) natively, in the
+%   smallest of the three timestamp layouts, unless some codec
+%   registered by msgpack_register_ext/3 claims type -1.
+%
+%   @error resource_error(msgpack_budget(max_depth, Depth)) when the
+%   term nests deeper than Depth.
+%   @error type_error(acyclic_term, Term) for a cyclic Term without
+%   sharing.
+
+msgpack_encode(Term) --> msgpack_encode(Term, []).
+
+%!  msgpack_decode_all(+Bytes:list, -Terms:list) is semidet.
+%!  msgpack_decode_all(+Bytes:list, -Terms:list, +Options) is semidet.
+%!  msgpack_encode_all(+Terms:list, -Bytes:list) is semidet.
+%!  msgpack_encode_all(+Terms:list, -Bytes:list, +Options) is semidet.
+%
+%   Decode and encode batches of back-to-back msgpack//1 terms in one
+%   foreign call each, rather than one phrase per message. Encoding
+%   writes every term into one growing buffer and builds one list of
+%   bytes at the end. Decoding budgets apply to each message separately.
+%   Equivalent to sequence(msgpack, Terms) as a phrase on Bytes, only
+%   faster for many small messages. C implements the arity-3 predicates.
+
+msgpack_decode_all(Bytes, Terms) :- msgpack_decode_all(Bytes, Terms, []).
+
+msgpack_encode_all(Terms, Bytes) :- msgpack_encode_all(Terms, Bytes, []).
+
+%!  msgpack_size(+Term, -Size:nonneg) is semidet.
+%!  msgpack_size(+Term, -Size:nonneg, +Options) is semidet.
+%
+%   Size is the exact number of bytes that msgpack_encode//2 writes for
+%   Term, hence also msgpack//1. Walks the term using the encoder's own
+%   width selection but only counts bytes, never stores them. Useful for
+%   sizing a buffer before encoding into it. Fails if Term does not
+%   encode. C implements the arity-3 predicate.
+
+msgpack_size(Term, Size) :- msgpack_size(Term, Size, []).
+
+%!  msgpack_encode_into(+Buffer, +Offset0:nonneg, +Term,
+%!                      -Offset:nonneg) is semidet.
+%!  msgpack_encode_into(+Buffer, +Offset0:nonneg, +Term,
+%!                      -Offset:nonneg, +Options) is semidet.
+%
+%   Encodes Term in place, writing into the mutable Buffer from Offset0
+%   and unifying Offset with the offset just past the last byte written.
+%   Encoding allocates nothing and creates no Prolog list, provided that
+%   Term uses only standard formats. Extension terms still call the
+%   msgpack:type_ext_hook/3 hook.
+%
+%   Fails if the encoded Term does not fit between Offset0 and the end
+%   of Buffer, in which case the bytes after Offset0 are undefined. Use
+%   msgpack_size/2 beforehand for the space required. C implements the
+%   arity-5 predicate.
+
+msgpack_encode_into(Buffer, Offset0, Term, Offset) :-
+    msgpack_encode_into(Buffer, Offset0, Term, Offset, []).
+
+%!  msgpack_buffer_create(+Size:nonneg, -Buffer) is det.
+%!  msgpack_buffer_size(+Buffer, -Size:nonneg) is det.
+%!  msgpack_buffer_bytes(+Buffer, +Offset:nonneg, +Length:nonneg,
+%!                       -Bytes:list) is det.
+%
+%   A buffer is a blob wrapping a fixed block of Size mutable bytes,
+%   initially zero. The atom garbage collector frees the block along
+%   with the blob. Bytes unifies with the Length byte codes starting at
+%   Offset. C implements all three predicates.
+
+%!  msgpack_statistics(-Stats:list) is det.
+%!  msgpack_reset_statistics is det.
+%
+%   Stats lists the objects and payload bytes decoded and encoded by
+%   the C predicates since the last reset, summed over all threads and
+%   broken down by format family. Each element takes the form
+%   decode(Family, Objects, Bytes) or encode(Family, Objects, Bytes)
+%   where Family names a format, e.g. `fixint`, `str8` or `map16`.
+%   Bytes counts str, bin and ext payloads only. Families with no
+%   objects do not appear.
+%
+%   Counting needs the `STATISTICS=1` build option, which also sets the
+%   Prolog flag `msgpackc_statistics` to `true`. Without it, Stats is
+%   always empty. Each thread counts without locking; the query
+%   reads counters that other threads may be updating, so the sum
+%   reflects some recent moment rather than an atomic snapshot.
+
+%!  msgpack_latency(-Histograms:list) is det.
+%
+%   Histograms lists the wall-clock latencies of the messages decoded
+%   and encoded by the C predicates since the last reset, merged across
+%   all threads. Each element takes the form latency(Direction, Below,
+%   Histogram) for one direction, `decode` or `encode`, and one message
+%   size class. Below is the exclusive upper bound of the class in
+%   bytes: 16, 64, 256 and so on in powers of four up to 65536, then
+%   `inf`. Histogram lists Nanoseconds-Count pairs in ascending order
+%   where Nanoseconds is the lower bound of a bucket. Bucket widths
+%   grow with their bounds so that each bucket spans at most one eighth
+%   of its lower bound.
+%
+%   Messages that fail or throw do not count. Encoding counts only when
+%   writing bytes, not when sizing. Histograms need the `STATISTICS=1`
+%   build option, same as msgpack_statistics/1, and reset with it.
+
+%!  msgpack_latency_percentile(+Histogram:list, +Percentile:number,
+%!                             -Nanoseconds:nonneg) is semidet.
+%
+%   Nanoseconds is the lower bound of the bucket containing the given
+%   Percentile of a latency Histogram, e.g. 99 for the p99 tail. Fails
+%   for an empty Histogram.
+
+msgpack_latency_percentile(Histogram, Percentile, Nanoseconds) :-
+    pairs_values(Histogram, Counts),
+    sum_list(Counts, Total),
+    Total > 0,
+    Rank is max(1, ceiling(Total * Percentile / 100)),
+    latency_percentile(Histogram, Rank, Nanoseconds).
+
+latency_percentile([Nanoseconds0-Count|Histogram], Rank, Nanoseconds) :-
+    (   Rank =< Count
+    ->  Nanoseconds = Nanoseconds0
+    ;   Rank1 is Rank - Count,
+        latency_percentile(Histogram, Rank1, Nanoseconds)
+    ).
+
+%!  msgpack_thread_allocated(-Bytes:nonneg) is det.
+%
+%   Bytes of C heap allocated by the codec in the calling thread since
+%   the thread started: growing readers, writers and container stacks,
+%   and buffers. Messages small and shallow enough to fit the inline
+%   buffers allocate nothing. Always zero without the `STATISTICS=1`
+%   build option. C implements the predicate.
+
+%!  msgpack_accounting(:Goal, -Usage:list) is semidet.
+%
+%   Calls Goal once and unifies Usage with the resources it consumed,
+%   as differences in the statistics of the calling thread before and
+%   after the call:
+%
+%       - global(Bytes) for global-stack bytes still in use after Goal,
+%       i.e. the size of the terms Goal built and kept;
+%       - trail(Bytes) for trail-stack bytes;
+%       - atoms(Count) for atoms created, e.g. by map keys;
+%       - heap(Bytes) for Prolog's C heap where the allocator reports
+%       it, else zero;
+%       - c_bytes(Bytes) for heap bytes allocated by the codec itself,
+%       see msgpack_thread_allocated/1;
+%       - garbage_collections(Count) for collections during Goal.
+%
+%   Garbage collects first so that Goal starts on a compact stack. A
+%   collection during Goal reclaims garbage from before and during the
+%   call alike, and can make the global figure an underestimate; a
+%   non-zero garbage_collections(Count) flags this. Compares term
+%   representations by global and atom costs, e.g. decoding keys as
+%   strings versus atoms, or sizes stack limits for the largest
+%   expected message.
+
+msgpack_accounting(Goal, Usage) :-
+    garbage_collect,
+    accounting(Usage0),
+    once(Goal),
+    accounting(Usage1),
+    maplist(accounting_delta, Usage0, Usage1, Usage).
+
+accounting([ global(Global),
+             trail(Trail),
+             atoms(Atoms),
+             heap(Heap),
+             c_bytes(Bytes),
+             garbage_collections(Collections)
+           ]) :-
+    statistics(globalused, Global),
+    statistics(trailused, Trail),
+    statistics(atoms, Atoms),
+    (   catch(statistics(heapused, Heap), _, fail)
+    ->  true
+    ;   Heap = 0
+    ),
+    msgpack_thread_allocated(Bytes),
+    statistics(garbage_collection, [Collections|_]).
+
+accounting_delta(Usage0, Usage1, Usage) :-
+    Usage0 =.. [Name, Value0],
+    Usage1 =.. [Name, Value1],
+    Value is Value1 - Value0,
+    Usage =.. [Name, Value].
+
 %!  msgpack_nil// is semidet.
 %!  msgpack_false// is semidet.
 %!  msgpack_true// is semidet.
@@ -693,20 +1009,44 @@ msgpack_dict(OnPair, Dict) -->
 %
 %   In (++) mode, meaning fully ground with no variables, the ++Term
 %   first unifies Term with its Type and Ext bytes using
-%   msgpack:type_ext_hook/3 multi-file predicate.
+%   msgpack:type_ext_hook/3 multi-file predicate. Otherwise decodes the
+%   ext header in one deterministic pass, reading the format byte, its
+%   length and the type, before handing Type and Ext to the hook.
+%
+%   Both directions go through ext_dispatch/3 for the first answer of
+%   the hook.
 
 msgpack_ext(Term) -->
     { ground(Term),
       !,
-      msgpack:type_ext_hook(Type, Ext, Term)
+      ext_dispatch(Type, Ext, Term)
     },
     msgpack_ext(Type, Ext).
 msgpack_ext(Term) -->
-    msgpack_ext(Type, Ext),
-    !,
-    { msgpack:type_ext_hook(Type, Ext, Term)
+    ext_header(Type, Length),
+    ext_bytes(Length, Ext),
+    { ext_dispatch(Type, Ext, Term)
     }.
 
+ext_header(Type, Length) -->
+    [Format],
+    ext_length(Format, Length),
+    int8(Type).
+
+ext_length(Format, Length) -->
+    { fixext_length_format(Length, Format)
+    },
+    !.
+ext_length(Format, Length) -->
+    { ext_width_format(Width, Format)
+    },
+    !,
+    uint(Width, Length).
+
+ext_bytes(Length, Ext, Bytes0, Bytes) :-
+    length(Ext, Length),
+    append(Ext, Bytes, Bytes0).
+
 %!  msgpack_ext(?Type, ?Ext)// is semidet.
 %
 %   Type is a signed integer. Ext is a list of byte codes.
@@ -767,16 +1107,113 @@ ext_width_format( 8, 0xc7).
 ext_width_format(16, 0xc8).
 ext_width_format(32, 0xc9).
 
+%!  msgpack_register_ext(+Type:integer, +Functor:predicate_indicator,
+%!                       :Closure) is det.
+%
+%   Registers Closure as the codec for ext Type and for terms whose
+%   principal functor matches Name/Arity. Closure names a predicate
+%   called as call(Closure, Term, Bytes) in both directions: with Term
+%   bound to encode, with Bytes bound to decode. Replaces any earlier
+%   registration for the same Type.
+%
+%   The C encoder and decoder find the codec by type byte or functor
+%   without going through msgpack:type_ext_hook/3; the grammar finds it
+%   through the hook. Foreign libraries register native codecs with
+%   msgpackc_register_ext() from the C header. Register at load time,
+%   before encoding or decoding starts in other threads.
+
+msgpack_register_ext(Type, Name/Arity, Module:Closure) :-
+    !,
+    must_be(between(-128, 127), Type),
+    must_be(atom, Name),
+    must_be(nonneg, Arity),
+    must_be(atom, Closure),
+    register_ext(Type, Name/Arity, Module:Closure),
+    retractall(registered_ext(Type, _, _)),
+    assertz(registered_ext(Type, Name/Arity, Module:Closure)).
+msgpack_register_ext(_, Functor, _) :-
+    must_be(compound, Functor),
+    throw(error(type_error(predicate_indicator, Functor), _)).
+
+%!  ext_dispatch(?Type:integer, ?Ext:list, ?Term) is semidet.
+%
+%   Calls msgpack:type_ext_hook/3 for its first answer. Calling the hook
+%   itself keeps the meaning of cuts within its clauses, so a clause
+%   that cuts and fails vetoes those after it. SWI-Prolog's clause
+%   indexing selects the clauses by Type when decoding and by Term when
+%   encoding, so no separate index is needed; `make bench-dispatch`
+%   checks that the cost per object stays flat as hook clauses grow. The
+%   C codec dispatches through here as well.
+
+ext_dispatch(Type, Ext, Term) :-
+    msgpack:type_ext_hook(Type, Ext, Term),
+    !.
+
+%!  msgpack_register_term_ext(+Type:integer) is det.
+%
+%   Registers the native Prolog term codec for ext Type. Thereafter
+%   term(Term) encodes any acyclic Term built from atoms, compounds,
+%   lists, variables, strings, and integers and floats within 64 bits,
+%   and decodes back to a variant of it. Variables shared within Term
+%   stay shared. Other Prolog peers need the same registration; other
+%   peers skip the ext.
+%
+%   The payload lists each functor name and arity once, followed by the
+%   term in prefix order with arguments referring to the functors by
+%   index, so repeated functors cost a byte or two each. The C encoder
+%   and decoder handle the type directly. The msgpack//1 grammar handles
+%   it too, though only for ground terms.
+%
+%   Decoding applies the max_depth, max_elements and max_str_bytes
+%   budgets inside the payload as well, counting from the ext itself.
+%   Names become atoms only when the term uses them, and a malformed
+%   table creates no functors.
+
+msgpack_register_term_ext(Type) :-
+    must_be(between(-128, 127), Type),
+    register_term_ext(Type),
+    retractall(registered_ext(Type, _, _)),
+    assertz(registered_ext(Type, term/1, msgpackc:term_ext)).
+
+%!  msgpack_register_bignum_ext(+Type:integer) is det.
+%
+%   Registers the GMP bignum codec for ext Type, so that the C encoder
+%   and decoder handle integers beyond 64 bits as int(Integer). The
+%   payload is a sign byte followed by the big-endian magnitude. Each
+%   integer has one encoding only; decoding rejects payloads with
+%   leading zeros or values that fit the int formats. Sets the Prolog
+%   flag `msgpackc_bignum_type` to Type. The msgpack//1 grammar does not
+%   handle the type.
+%
+%   @error existence_error(build_option, gmp) unless built with `GMP=1`.
+
+msgpack_register_bignum_ext(Type) :-
+    must_be(between(-128, 127), Type),
+    register_bignum_ext(Type).
+
+msgpack:type_ext_hook(Type, Ext, Term) :-
+    registered_ext(Type, Name/Arity, Closure),
+    (   ground(Term)
+    ->  functor(Term, Name, Arity)
+    ;   true
+    ),
+    call(Closure, Term, Ext).
+
 %!  msgpack:type_ext_hook(Type:integer, Ext:list, Term) is semidet.
 %
 %   Parses the extension byte block.
 %
 %   The timestamp extension encodes seconds and nanoseconds since 1970,
 %   also called Unix epoch time. Three alternative encodings exist: 4
-%   bytes, 8 bytes and 12 bytes.
+%   bytes, 8 bytes and 12 bytes. Term takes the form timestamp(Epoch)
+%   for a number of seconds, or timestamp(Sec, NSec) for integer
+%   seconds and nanoseconds without the rounding of floating-point
+%   arithmetic. Decoding an unbound Term gives the former.
 
 msgpack:type_ext_hook(-1, Ext, timestamp(Epoch)) :-
     once(phrase(timestamp(Epoch), Ext)).
+msgpack:type_ext_hook(-1, Ext, timestamp(Sec, NSec)) :-
+    once(phrase(timestamp(Sec, NSec), Ext)).
 
 timestamp(Epoch) -->
     { var(Epoch)
@@ -790,7 +1227,7 @@ timestamp(Epoch) -->
     sec_nsec(Seconds, NanoSeconds).
 
 epoch(Epoch) -->
-    int32(Epoch).
+    uint32(Epoch).
 epoch(Epoch) -->
     uint64(UInt64),
     { NanoSeconds is UInt64 >> 34,
@@ -804,12 +1241,36 @@ epoch(Epoch) -->
     { tv(Epoch, Seconds, NanoSeconds)
     }.
 
+timestamp(Sec, NSec) -->
+    { integer(Sec),
+      integer(NSec),
+      !,
+      NSec >= 0,
+      NSec < 1 000 000 000
+    },
+    sec_nsec(Sec, NSec).
+timestamp(Sec, 0) -->
+    uint32(Sec).
+timestamp(Sec, NSec) -->
+    uint64(UInt64),
+    { NSec is UInt64 >> 34,
+      NSec < 1 000 000 000,
+      Sec is UInt64 /\ ((1 << 34) - 1)
+    }.
+timestamp(Sec, NSec) -->
+    uint32(NSec),
+    int64(Sec),
+    { NSec < 1 000 000 000
+    }.
+
 sec_nsec(Seconds, 0) -->
-    { Seconds < (1 << 32)
+    { Seconds >= 0,
+      Seconds < (1 << 32)
     },
-    int32(Seconds).
+    uint32(Seconds).
 sec_nsec(Seconds, NanoSeconds) -->
-    { Seconds < (1 << 34),
+    { Seconds >= 0,
+      Seconds < (1 << 34),
       UInt64 is (NanoSeconds << 34) \/ Seconds
     },
     uint64(UInt64).
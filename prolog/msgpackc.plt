@@ -40,6 +40,273 @@ test(msgpack_objects, [true(A == [nil, false, true]), nondet]) :-
 test(msgpack_objects, [true(A == [0xc0, 0xc2, 0xc3])]) :-
     phrase(msgpack_objects([nil, false, true]), A).
 
+test(msgpack_decode, true(A == array([int(1), str("a"), map([nil-float(1.5)])]))) :-
+    phrase(msgpack(array([int(1), str("a"), map([nil-float(1.5)])])), B),
+    phrase(msgpack_decode(A), B).
+test(msgpack_decode, true(A-B == int(-1)-[0xc0])) :-
+    phrase(msgpack_decode(A), [0xff, 0xc0], B).
+test(msgpack_decode, fail) :-
+    phrase(msgpack_decode(_), [0xa2, 0x61]).
+test(msgpack_decode, error(resource_error(msgpack_budget(max_depth, 1)))) :-
+    phrase(msgpack_decode(_, [max_depth(1)]), [0x91, 0x91, 0x01]).
+test(msgpack_decode, error(resource_error(msgpack_budget(max_elements, 3)))) :-
+    phrase(msgpack_decode(_, [max_elements(3)]), [0xdd, 0xff, 0xff, 0xff, 0xff]).
+test(msgpack_decode, error(resource_error(msgpack_budget(max_str_bytes, 2)))) :-
+    phrase(msgpack_decode(_, [max_str_bytes(2)]), [0xa3|`abc`]).
+test(msgpack_decode, error(resource_error(msgpack_budget(max_total_bytes, 4)))) :-
+    phrase(msgpack_decode(_, [max_total_bytes(4)]), [0xa4|`abcd`]).
+test(msgpack_decode, error(syntax_error(msgpack(invalid_lead_byte, 1)))) :-
+    phrase(msgpack_decode(_, [strict(true)]), [0x92, 0xc1, 0xc0]).
+test(msgpack_decode, error(syntax_error(msgpack(truncated, 2)))) :-
+    phrase(msgpack_decode(_, [strict(true)]), [0xa2, 0x61]).
+test(msgpack_decode, error(syntax_error(msgpack(bad_utf8, 2)))) :-
+    phrase(msgpack_decode(_, [strict(true)]), [0xa2, 0x61, 0xff]).
+
+test(msgpack_encode, true(A == B)) :-
+    Term = array([ int(1), int(-33), int(300), int(-40000),
+                   float(1.5), float(0.1),
+                   str("hello"), bin([1, 2]),
+                   map([str("a")-nil, bool(true)-bool(false)]),
+                   timestamp(0)
+                 ]),
+    phrase(msgpack(Term), A),
+    phrase(msgpack_encode(Term), B).
+test(msgpack_encode, true(A == Term)) :-
+    nested(10 000, Term),
+    phrase(msgpack_encode(Term), B),
+    phrase(msgpack_decode(A), B).
+test(msgpack_encode, error(resource_error(msgpack_budget(max_depth, 100)))) :-
+    A = array([A]),
+    phrase(msgpack_encode(A, [max_depth(100)]), _).
+
+test(msgpack_codec_create, error(syntax_error(msgpack(truncated, 1)))) :-
+    msgpack_codec_create([strict(true), max_depth(8)], Codec),
+    phrase(msgpack_decode(_, Codec), [0xd0]).
+test(msgpack_codec_create, true(A == array([array([])]))) :-
+    msgpack_codec_create([unknown(1), unknown, max_depth(1, 2), 7], Codec),
+    phrase(msgpack_decode(A, Codec), [0x91, 0x90]).
+test(msgpack_codec_create, error(type_error(integer, deep))) :-
+    msgpack_codec_create([max_depth(deep)], _).
+test(msgpack_codec_create, error(type_error(list, foo))) :-
+    msgpack_codec_create([strict(true)|foo], _).
+test(msgpack_codec_create, true(A == int(1))) :-
+    msgpack_codec_create([], Codec),
+    phrase(msgpack_encode(int(1), Codec), B),
+    phrase(msgpack_decode(A, Codec), B).
+
+test(msgpack_encode_all, true(A-B == C-Terms)) :-
+    Terms = [nil, int(1), str("x"), array([]), map([int(1)-bool(true)])],
+    msgpack_encode_all(Terms, A),
+    phrase(sequence(msgpack, Terms), C),
+    msgpack_decode_all(A, B).
+test(msgpack_decode_all, true(A == [])) :-
+    msgpack_decode_all([], A).
+test(msgpack_decode_all, error(resource_error(msgpack_budget(max_total_bytes, 2)))) :-
+    msgpack_decode_all([0xc0, 0x92, 0xc0, 0xc0], _, [max_total_bytes(2)]).
+
+test(msgpack_size, true(Size == Length)) :-
+    Term = map([ str("abc")-array([int(1), int(1 000 000), float(0.1)]),
+                 bin([1, 2, 3])-timestamp(1.5)
+               ]),
+    msgpack_size(Term, Size),
+    phrase(msgpack(Term), Bytes),
+    length(Bytes, Length).
+test(msgpack_size, [condition(\+ current_prolog_flag(msgpackc_bignum_type, _)), fail]) :-
+    A is 1 << 64,
+    msgpack_size(int(A), _).
+
+test(bignum, [ condition(bignum_type(_)),
+               forall(member(Expr, [-(1 << 64), -(1 << 63) - 1, 1 << 64, 1 << 200])),
+               true(A == int(N))
+             ]) :-
+    N is Expr,
+    phrase(msgpack_encode(int(N)), Bytes),
+    phrase(msgpack_decode(A), Bytes).
+test(bignum, [ condition(bignum_type(_)),
+               forall(member(Ext, [ [0, 0, 1, 2, 3, 4, 5, 6, 7, 8],
+                                    [1, 0x80, 0, 0, 0, 0, 0, 0, 0],
+                                    [0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff],
+                                    [1]
+                                  ])),
+               error(syntax_error(msgpack(bad_ext, 3)))
+             ]) :-
+    bignum_type(Type),
+    length(Ext, Length),
+    phrase(msgpack_decode(_, [strict(true)]), [0xc7, Length, Type|Ext]).
+test(bignum, [ condition(\+ bignum_type(_)),
+               error(existence_error(build_option, gmp))
+             ]) :-
+    msgpack_register_bignum_ext(46).
+
+%   Registers the bignum codec for type 46 unless already registered at
+%   load time, and only when built with GMP.
+
+bignum_type(Type) :-
+    current_prolog_flag(msgpackc_bignum_type, Type),
+    !.
+bignum_type(46) :-
+    catch(msgpack_register_bignum_ext(46), error(existence_error(build_option, gmp), _), fail).
+
+test(msgpack_encode_into, true(A-B == C-D)) :-
+    Term = array([int(1), str("a")]),
+    msgpack_buffer_create(16, Buffer),
+    msgpack_encode_into(Buffer, 2, Term, Offset),
+    A is Offset - 2,
+    msgpack_buffer_bytes(Buffer, 2, A, B),
+    phrase(msgpack(Term), D),
+    length(D, C).
+test(msgpack_encode_into, fail) :-
+    msgpack_buffer_create(4, Buffer),
+    msgpack_encode_into(Buffer, 0, str("hello"), _).
+
+test(msgpack_statistics, [ condition(current_prolog_flag(msgpackc_statistics, true)),
+                           true(Stats-Messages ==
+                                [ decode(fixint, 1, 0),
+                                  decode(fixarray, 1, 0),
+                                  decode(fixstr, 1, 3),
+                                  decode(bin8, 1, 2),
+                                  encode(fixint, 1, 0),
+                                  encode(fixarray, 1, 0),
+                                  encode(fixstr, 1, 3),
+                                  encode(bin8, 1, 2)
+                                ]-[decode-1, encode-1])
+                         ]) :-
+    msgpack_reset_statistics,
+    phrase(msgpack_encode(array([int(1), str("abc"), bin([1, 2])])), Bytes),
+    phrase(msgpack_decode(_), Bytes),
+    msgpack_statistics(Stats),
+    msgpack_latency(Histograms),
+    findall(Direction-Count,
+            ( member(latency(Direction, _, Histogram), Histograms),
+              pairs_values(Histogram, Counts),
+              sum_list(Counts, Count)
+            ), Messages).
+test(msgpack_statistics, [ condition(\+ current_prolog_flag(msgpackc_statistics, true)),
+                           true(Stats == [])
+                         ]) :-
+    phrase(msgpack_encode(array([int(1), str("a")])), Bytes),
+    phrase(msgpack_decode(_), Bytes),
+    msgpack_statistics(Stats).
+
+test(msgpack_latency, [ condition(current_prolog_flag(msgpackc_statistics, true)),
+                        true(Messages-Bounded == [ decode-16-3, decode-256-1,
+                                                   encode-16-3, encode-256-1
+                                                 ]-true)
+                      ]) :-
+    length(Codes, 97),
+    maplist(=(0'x), Codes),
+    string_codes(String, Codes),
+    msgpack_reset_statistics,
+    get_time(Started),
+    forall(member(Term, [int(1), nil, bool(true), str(String)]),
+           ( phrase(msgpack_encode(Term), Bytes),
+             phrase(msgpack_decode(_), Bytes)
+           )),
+    get_time(Stopped),
+    Elapsed is ceiling((Stopped - Started) * 1e9),
+    msgpack_latency(Histograms),
+    findall(Direction-Below-Count,
+            ( member(latency(Direction, Below, Histogram), Histograms),
+              pairs_values(Histogram, Counts),
+              sum_list(Counts, Count)
+            ), Messages),
+    (   forall(member(latency(_, _, Histogram), Histograms),
+               ( msgpack_latency_percentile(Histogram, 0, P0),
+                 msgpack_latency_percentile(Histogram, 50, P50),
+                 msgpack_latency_percentile(Histogram, 100, P100),
+                 P0 =< P50, P50 =< P100, P100 =< Elapsed
+               ))
+    ->  Bounded = true
+    ;   Bounded = false
+    ).
+
+test(msgpack_latency_percentile, true(A-B-C == 10-10-80)) :-
+    Histogram = [10-98, 40-1, 80-1],
+    msgpack_latency_percentile(Histogram, 0, A),
+    msgpack_latency_percentile(Histogram, 50, B),
+    msgpack_latency_percentile(Histogram, 100, C).
+test(msgpack_latency_percentile, true(A-B == 40-80)) :-
+    Histogram = [10-1, 40-1, 80-2],
+    msgpack_latency_percentile(Histogram, 50, A),
+    msgpack_latency_percentile(Histogram, 51, B).
+test(msgpack_latency_percentile, fail) :-
+    msgpack_latency_percentile([], 99, _).
+test(msgpack_latency_percentile, fail) :-
+    msgpack_latency_percentile([10-0], 0, _).
+
+test(msgpack_accounting, true(Global > 0)) :-
+    numlist(1, 100, Numbers),
+    findall(int(Number), member(Number, Numbers), Ints),
+    phrase(msgpack_encode(array(Ints)), Bytes),
+    msgpack_accounting(phrase(msgpack_decode(_), Bytes), Usage),
+    memberchk(global(Global), Usage).
+
+test(msgpack_register_ext, true(A-B == Term-Term)) :-
+    msgpack_register_ext(42, point/2, point_ext),
+    Term = array([point(1, 2), int(3)]),
+    phrase(msgpack_encode(Term), Bytes),
+    phrase(msgpack(Term), Bytes),
+    phrase(msgpack_decode(A), Bytes),
+    phrase(msgpack(B), Bytes).
+
+point_ext(point(X, Y), [X, Y]).
+
+test(msgpack_register_term_ext, true(A =@= Term)) :-
+    msgpack_register_term_ext(43),
+    Term = term(f(X, "s", [a, 1.5, -7|T], [], 'A b', g(X), T)),
+    phrase(msgpack_encode(Term), Bytes),
+    phrase(msgpack_decode(A), Bytes).
+test(msgpack_register_term_ext, true(A-B == Bytes-Term)) :-
+    msgpack_register_term_ext(43),
+    Term = term(f(a, [g(a)], "b")),
+    phrase(msgpack_encode(Term), Bytes),
+    phrase(msgpack(Term), A),
+    phrase(msgpack(B), Bytes).
+test(msgpack_register_term_ext, error(syntax_error(msgpack(bad_ext, 3)))) :-
+    msgpack_register_term_ext(43),
+    Payload = [0x92, 0xa1, 0'f, 0xce, 0xff, 0xff, 0xff, 0xff, 0x00, 0x91, 0x03],
+    length(Payload, Length),
+    phrase(msgpack_decode(_, [strict(true)]), [0xc7, Length, 43|Payload]).
+test(msgpack_register_term_ext, error(resource_error(msgpack_budget(max_depth, 1)))) :-
+    msgpack_register_term_ext(43),
+    phrase(msgpack_encode(term(f(g(a)))), Bytes),
+    phrase(msgpack_decode(_, [max_depth(1)]), Bytes).
+test(msgpack_register_term_ext, error(resource_error(msgpack_budget(max_elements, 5)))) :-
+    msgpack_register_term_ext(43),
+    phrase(msgpack_encode(term([1, 2, 3, 4, 5, 6])), Bytes),
+    phrase(msgpack_decode(_, [max_elements(5)]), Bytes).
+
+test(share, true(A-B == Term-true)) :-
+    S = map([str("key")-array([int(1), str("value")])]),
+    Term = array([S, S, array([S, str("value")])]),
+    phrase(msgpack_encode(Term, [share(44)]), Bytes),
+    phrase(msgpack_decode(A, [share(44)]), Bytes),
+    msgpack_size(Term, Size, [share(44)]),
+    msgpack_size(Term, Unshared),
+    length(Bytes, Size),
+    (   Size < Unshared
+    ->  B = true
+    ;   B = false
+    ).
+test(share, true(B == A)) :-
+    A = array([str("cycle"), A]),
+    phrase(msgpack_encode(A, [share(44)]), Bytes),
+    phrase(msgpack_decode(B, [share(44)]), Bytes).
+test(share, error(syntax_error(msgpack(bad_reference, 3)))) :-
+    phrase(msgpack_decode(_, [share(44), strict(true)]), [0x91, 0xd4, 44, 1]).
+test(share, true(A == Terms)) :-
+    S = str("shared"),
+    T = array([S, S]),
+    Terms = [array([T, T, S]), T, map([S-T])],
+    msgpack_encode_all(Terms, Bytes, [share(44)]),
+    msgpack_decode_all(Bytes, A, [share(44)]).
+test(share, error(type_error(acyclic_term, _))) :-
+    A = array([A]),
+    phrase(msgpack_encode(A), _).
+
+nested(0, nil) :- !.
+nested(N, array([Term])) :- M is N - 1, nested(M, Term).
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 C implements the float32//1 and float64//1 predicates.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -110,6 +377,43 @@ test(msgpack_bin, true(A == [1, 2, 3])) :-
 
 test(timestamp, true(A == [214, 255, 0, 0, 0, 0])) :-
     phrase(sequence(msgpack, [timestamp(0)]), A).
+test(timestamp, true(A == timestamp(0))) :-
+    phrase(msgpack_ext(A), [0xc7, 4, 0xff, 0, 0, 0, 0]).
+
+test(timestamp, true(A-B == C-timestamp(-1, 5))) :-
+    phrase(msgpack(timestamp(-1, 5)), C),
+    phrase(msgpack_encode(timestamp(-1, 5)), A),
+    phrase(msgpack_decode(B, [timestamp(sec_nsec)]), A).
+test(timestamp, true(A == [0xd7, 0xff, 0, 0, 0, 0x14, 0, 0, 0, 1])) :-
+    phrase(msgpack_encode(timestamp(1, 5)), A).
+test(timestamp, [ forall(member(Epoch, [ 0, 0xffffffff, 0x100000000,
+                                         0x3ffffffff, 0x400000000
+                                       ])),
+                  true(A-B == C-timestamp(Epoch, 0))
+                ]) :-
+    phrase(msgpack(timestamp(Epoch)), C),
+    phrase(msgpack_encode(timestamp(Epoch)), A),
+    phrase(msgpack_decode(B, [timestamp(sec_nsec)]), A).
+test(timestamp, [forall(member(Epoch, [-1, -0.5])), fail]) :-
+    (   phrase(msgpack(timestamp(Epoch)), _)
+    ;   phrase(msgpack_encode(timestamp(Epoch)), _)
+    ).
+
+test(msgpack_ext, fail) :-
+    phrase(msgpack_ext(_), [0xd4, 99, 0]).
+test(msgpack_ext, fail) :-
+    phrase(msgpack(vetoed), _).
+test(msgpack_ext, fail) :-
+    phrase(msgpack_encode(vetoed), _).
+test(msgpack_ext, fail) :-
+    phrase(msgpack_ext(_), [0xc7, 0, 45]).
+test(msgpack_ext, fail) :-
+    phrase(msgpack_decode(_), [0xc7, 0, 45]).
+
+:- multifile msgpack:type_ext_hook/3.
+
+msgpack:type_ext_hook(45, _, vetoed) :- !, fail.
+msgpack:type_ext_hook(45, [], vetoed).
 
 endian(Endian) :- term_hash(aap, Hash), endian(Hash, Endian).
 